@@ -0,0 +1,247 @@
+#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable
+
+/**
+ * OpenCL representation of a triangle. Matches the memory layout
+ * of the Triangle struct in src/geometry/geometry.hpp
+ */
+typedef struct def_Triangle {
+    uint vertices[3];
+} Triangle;
+
+/**
+ * OpenCL representation of a node of the triangle BVH. Matches the memory
+ * layout of the BVHNode struct in src/simulation/geometry.hpp
+ */
+typedef struct def_BVHNode {
+    float lower[3];
+    int left;       // Index of the left child node, -1 for leaves
+    float upper[3];
+    int right;      // Index of the right child node, or the triangle of a leaf
+} BVHNode;
+
+#define ID get_global_id(0)
+
+/// The n - 1 internal nodes come first, with the root at 0, followed by the n leaves in Morton order
+#define LEAF(i, numTriangles) ((numTriangles) - 1 + (i))
+
+/// Number of bits per axis of the Morton codes
+#define MORTON_BITS 10
+
+/**
+ * Maps a float to a uint with the same order, so that floats of any sign can be reduced with
+ * atomic_min and atomic_max. Positive floats get the sign bit set, negative floats are inverted.
+ */
+inline uint as_ordered_uint(const float value) {
+    const uint bits = as_uint(value);
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+inline float from_ordered_uint(const uint bits) {
+    return as_float((bits & 0x80000000u) ? bits & 0x7FFFFFFFu : ~bits);
+}
+
+inline float3 triangle_centroid(__global const Triangle *triangles,
+                                __global const float3 *positions,
+                                const uint triangleID) {
+    const Triangle triangle = triangles[triangleID];
+    return (positions[triangle.vertices[0]] + positions[triangle.vertices[1]] + positions[triangle.vertices[2]])
+           / 3.0f;
+}
+
+/**
+ * Spreads the lowest 10 bits of v to every third bit.
+ */
+inline uint expand_bits(uint v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+/**
+ * (runs for every triangle)
+ *
+ * Reduces the bounding box of the triangle centroids into [min xyz, max xyz], mapped by as_ordered_uint,
+ * which must be reset to [0xFFFFFFFF x 3, 0 x 3] before the launch.
+ */
+__kernel void calc_centroid_bounds(__global const Triangle  *triangles,         // 0
+                                   __global const float3    *positions,         // 1
+                                   volatile __global uint   *centroidBounds) {  // 2
+
+    const float3 centroid = triangle_centroid(triangles, positions, ID);
+
+    atomic_min(&centroidBounds[0], as_ordered_uint(centroid.x));
+    atomic_min(&centroidBounds[1], as_ordered_uint(centroid.y));
+    atomic_min(&centroidBounds[2], as_ordered_uint(centroid.z));
+    atomic_max(&centroidBounds[3], as_ordered_uint(centroid.x));
+    atomic_max(&centroidBounds[4], as_ordered_uint(centroid.y));
+    atomic_max(&centroidBounds[5], as_ordered_uint(centroid.z));
+}
+
+/**
+ * (runs for every triangle)
+ *
+ * Calculates the 30-bit Morton code of the triangle's centroid within the centroid bounds, and writes the
+ * triangle ID next to it for the sort.
+ */
+__kernel void calc_morton_codes(__global const Triangle *triangles,         // 0
+                                __global const float3   *positions,         // 1
+                                __global const uint     *centroidBounds,    // 2
+                                __global uint           *mortonCodes,       // 3
+                                __global uint           *triangleIDs) {     // 4
+
+    const float3 lower = (float3)(from_ordered_uint(centroidBounds[0]),
+                                  from_ordered_uint(centroidBounds[1]),
+                                  from_ordered_uint(centroidBounds[2]));
+    const float3 upper = (float3)(from_ordered_uint(centroidBounds[3]),
+                                  from_ordered_uint(centroidBounds[4]),
+                                  from_ordered_uint(centroidBounds[5]));
+
+    const float3 extent = max(upper - lower, (float3)(1e-6f, 1e-6f, 1e-6f));
+    const float3 normalized = (triangle_centroid(triangles, positions, ID) - lower) / extent;
+    const uint3 cell = convert_uint3(clamp(normalized * (1 << MORTON_BITS),
+                                           0.0f, (float) ((1 << MORTON_BITS) - 1)));
+
+    mortonCodes[ID] = (expand_bits(cell.x) << 2) | (expand_bits(cell.y) << 1) | expand_bits(cell.z);
+    triangleIDs[ID] = ID;
+}
+
+/**
+ * Length of the common prefix of the (sorted) Morton codes i and j, -1 if j is out of range. Equal
+ * codes are told apart by their indices, so that every code is unique.
+ */
+inline int common_prefix(__global const uint *mortonCodes, const int numTriangles, const int i, const int j) {
+    if (j < 0 || j >= numTriangles) return -1;
+
+    const uint codeI = mortonCodes[i];
+    const uint codeJ = mortonCodes[j];
+    return codeI == codeJ ? 32 + clz((uint) (i ^ j)) : clz(codeI ^ codeJ);
+}
+
+/**
+ * (runs for every triangle)
+ *
+ * Emits internal node i (for i < n - 1) of the binary radix tree over the sorted Morton codes, independently
+ * of all other nodes. T. Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees",
+ * HPG 2012. Also assigns the sorted triangle i to leaf i. The boxes are calculated by refit_bounds.
+ */
+__kernel void build_hierarchy(__global const uint   *mortonCodes,   // 0
+                              __global const uint   *triangleIDs,   // 1
+                              __global BVHNode      *nodes,         // 2
+                              __global int          *parents,       // 3
+                              const uint            numTriangles) { // 4
+
+    const int n = numTriangles;
+    const int i = ID;
+
+    nodes[LEAF(i, n)].left = -1;
+    nodes[LEAF(i, n)].right = triangleIDs[i];
+    if (i == 0) parents[0] = -1;
+    if (i >= n - 1) return;
+
+    /// the direction of the node's range, towards the neighbour with the longer common prefix
+    const int d = common_prefix(mortonCodes, n, i, i + 1) - common_prefix(mortonCodes, n, i, i - 1) > 0 ? 1 : -1;
+
+    /// the other end of the range, every code in it has a longer common prefix than the neighbour outside
+    const int minPrefix = common_prefix(mortonCodes, n, i, i - d);
+    int maxLength = 2;
+    while (common_prefix(mortonCodes, n, i, i + maxLength * d) > minPrefix) maxLength *= 2;
+
+    int length = 0;
+    for (int t = maxLength / 2; t >= 1; t /= 2) {
+        if (common_prefix(mortonCodes, n, i, i + (length + t) * d) > minPrefix) length += t;
+    }
+    const int j = i + length * d;
+
+    /// the split, where the common prefix of the range ends
+    const int nodePrefix = common_prefix(mortonCodes, n, i, j);
+    int split = 0;
+    int t = length;
+    do {
+        t = (t + 1) >> 1;
+        if (common_prefix(mortonCodes, n, i, i + (split + t) * d) > nodePrefix) split += t;
+    } while (t > 1);
+    const int gamma = i + split * d + min(d, 0);
+
+    const int left = min(i, j) == gamma ? LEAF(gamma, n) : gamma;
+    const int right = max(i, j) == gamma + 1 ? LEAF(gamma + 1, n) : gamma + 1;
+
+    nodes[i].left = left;
+    nodes[i].right = right;
+    parents[left] = i;
+    parents[right] = i;
+}
+
+inline float surface_area(const float3 lower, const float3 upper) {
+    const float3 extent = upper - lower;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+void atomic_add_global_float(volatile __global float *addr, float val) {
+    union {
+        unsigned int u32;
+        float        f32;
+    } next, expected, current;
+    current.f32 = *addr;
+    do {
+        expected.f32 = current.f32;
+        next.f32     = expected.f32 + val;
+        current.u32  = atomic_cmpxchg((volatile __global unsigned int *) addr, expected.u32, next.u32);
+    } while (current.u32 != expected.u32);
+}
+
+/**
+ * (runs for every leaf)
+ *
+ * Fits the leaf's box to its triangle, grown by padding, and walks up the tree. The second work-item that
+ * arrives at an internal node (counted in refitCounters, which must be 0 before the launch) fits the node to
+ * the boxes of both of its children and continues to the parent, the first one stops. Adds the surface area
+ * of the internal nodes to surfaceArea, which must be 0 before the launch, as a measure of the tree's quality.
+ */
+__kernel void refit_bounds(__global const Triangle  *triangles,         // 0
+                           __global const float3    *positions,         // 1
+                           volatile __global BVHNode *nodes,            // 2
+                           __global const int       *parents,           // 3
+                           volatile __global uint   *refitCounters,     // 4
+                           volatile __global float  *surfaceArea,       // 5
+                           const uint               numTriangles,       // 6
+                           const float              padding) {          // 7
+
+    int node = LEAF(ID, numTriangles);
+
+    const Triangle triangle = triangles[nodes[node].right];
+    const float3 p1 = positions[triangle.vertices[0]];
+    const float3 p2 = positions[triangle.vertices[1]];
+    const float3 p3 = positions[triangle.vertices[2]];
+    float3 lower = min(min(p1, p2), p3) - padding;
+    float3 upper = max(max(p1, p2), p3) + padding;
+
+    nodes[node].lower[0] = lower.x; nodes[node].lower[1] = lower.y; nodes[node].lower[2] = lower.z;
+    nodes[node].upper[0] = upper.x; nodes[node].upper[1] = upper.y; nodes[node].upper[2] = upper.z;
+
+    float area = 0.0f;
+    node = parents[node];
+    while (node >= 0) {
+        // the box of this child must be visible to the work-item that fits the parent
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        if (atomic_inc(&refitCounters[node]) == 0) break;
+
+        const int left = nodes[node].left;
+        const int right = nodes[node].right;
+        lower = min((float3)(nodes[left].lower[0], nodes[left].lower[1], nodes[left].lower[2]),
+                    (float3)(nodes[right].lower[0], nodes[right].lower[1], nodes[right].lower[2]));
+        upper = max((float3)(nodes[left].upper[0], nodes[left].upper[1], nodes[left].upper[2]),
+                    (float3)(nodes[right].upper[0], nodes[right].upper[1], nodes[right].upper[2]));
+
+        nodes[node].lower[0] = lower.x; nodes[node].lower[1] = lower.y; nodes[node].lower[2] = lower.z;
+        nodes[node].upper[0] = upper.x; nodes[node].upper[1] = upper.y; nodes[node].upper[2] = upper.z;
+        area += surface_area(lower, upper);
+
+        node = parents[node];
+    }
+
+    if (area > 0.0f) {
+        atomic_add_global_float(surfaceArea, area);
+    }
+}
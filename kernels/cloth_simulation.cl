@@ -34,12 +34,91 @@ typedef struct def_ClothTriangleData {
     float mass;
 } ClothTriangleData;
 
+typedef struct def_ClothRange {
+    uint vertexOffset;  // Offset of the cloth's first vertex into the shared vertex buffers
+    uint numVertices;
+    uint numEdges;
+} ClothRange;
+
+typedef struct def_StretchConstraint {
+    int vertices[2];    // [p1, p2] of the edge
+    float restLength;
+} StretchConstraint;
+
+typedef struct def_BendConstraint {
+    int vertices[4];    // [p1, p2, p3, p4] of an edge shared by two triangles
+    float restAngle;
+} BendConstraint;
+
+typedef struct def_ProlongationStencil {
+    int vertexID;       // Vertex of the finer level that is not part of the coarse level
+    int parents[4];     // Indices of its coarse neighbours into the level buffers, -1 = unused
+    float weights[4];
+} ProlongationStencil;
+
+typedef struct def_ConstraintPartition {
+    uint vertexOffset;          // The local vertices are [vertexOffset, vertexOffset + numVertices) of the partition vertices
+    uint numVertices;
+    uint numInteriorVertices;   // The first numInteriorVertices local vertices are moved by no other partition
+    uint stretchOffset;         // Offset of the partition's constraints into the partition stretch constraints
+    uint numStretchConstraints;
+    uint bendOffset;            // Offset of the partition's constraints into the partition bend constraints
+    uint numBendConstraints;
+} ConstraintPartition;
+
+typedef struct def_PartitionConstraint {
+    uint constraintID;          // Index into the stretch or bend constraints
+    uint localVertices[4];      // Indices into the local vertices of the partition, [2, 3] unused by stretch constraints
+} PartitionConstraint;
+
+/// Types of analytic colliders, matches pbd::ColliderType
+#define COLLIDER_PLANE 0
+#define COLLIDER_SPHERE 1
+#define COLLIDER_CAPSULE 2
+#define COLLIDER_BOX 3
+
+typedef struct def_ColliderPrimitive {
+    uint type;          // One of the COLLIDER_ types
+    float radius;       // Of spheres and capsules
+    float a[3];         // Plane normal, sphere center, first capsule end or box center
+    float b[3];         // [offset of the plane along its normal, -, -], second capsule end or box half extents
+    float rotation[4];  // Orientation quaternion [x, y, z, w] of boxes
+} ColliderPrimitive;
 
 typedef struct def_ClothSimParams {
     uint numSubSteps;   // Number of PBD constraint projection steps
     float deltaTime;    // Time step (dt):
     float k_stretch;    // PBD stiffness constant for cloth stretch constraint
     float k_bend;       // PBD stiffness constant for cloth bending constraint
+    uint solverMode;    // How the constraints are projected, matches pbd::SolverMode
+    uint fuseSubSteps;  // If != 0, ground clipping is done by the projection kernels instead of clip_to_planes
+    uint useLocalSolver;// If != 0, cloths that fit in local memory are solved by solve_cloth_local
+    float compliance_stretch;   // XPBD compliance (inverse stiffness) of the cloth stretch constraint
+    float compliance_bend;      // XPBD compliance (inverse stiffness) of the cloth bending constraint
+    uint bendInterval;          // Bend constraints are projected every bendInterval-th substep (JACOBI_ATOMIC)
+    uint convergenceCheckInterval;  // The constraint violation is checked every N-th substep, 0 = never
+    float convergenceTolerance;     // The substeps stop once the max relative stretch is below this
+    uint useChebyshev;      // If != 0, correct_predictions is accelerated by the Chebyshev semi-iterative method
+    float spectralRadius;   // Estimated spectral radius of the Jacobi iteration, used for the Chebyshev weights
+    uint chebyshevWarmUp;   // Number of plain Jacobi substeps before the Chebyshev acceleration starts
+    float overRelaxation;   // Scale of the position corrections in correct_predictions (1 = plain Jacobi)
+    uint multigridSmoothingSteps;   // Jacobi iterations per intermediate multigrid level and V-cycle
+    uint multigridCoarseSteps;      // Jacobi iterations on the coarsest multigrid level per V-cycle
+    uint useSleeping;   // If != 0, resting sleep clusters are skipped (JACOBI_ATOMIC)
+    float sleepSpeed;   // A sleep cluster is calm in a frame if all of its vertices are slower than this
+    uint sleepFrames;   // A sleep cluster falls asleep after this many consecutive calm frames
+    uint useSmallSteps; // If != 0, the host splits every frame into numSubSteps steps of one iteration each
+    uint usePartitions; // If != 0, JACOBI_ATOMIC uses calc_partition_position_corrections
+    uint useSelfCollision;      // If != 0, the host resolves self-collisions with kernels/counting_sort.cl
+    float collisionDistance;    // Min distance between two vertices that aren't neighbours at rest
+    uint collideEverySubStep;   // If != 0, collisions are resolved after every substep
+    uint useClothCollision;     // If != 0, the host resolves collisions between cloths as well
+    uint useTriangleBVH;        // If != 0, the host refits a triangle BVH with kernels/bvh.cl every frame
+    float bvhRebuildRatio;      // The BVH is rebuilt once its surface area has grown by this factor
+    uint useHashGrid;           // If != 0, the collision grid hashes its cells, see kernels/counting_sort.cl
+    float hashGridBucketsPerVertex; // Size of the hash table of the collision grid per vertex
+    uint useAdaptiveGrid;       // If != 0, the collision grid is fitted to the scene bounds every frame
+    uint useRadixSort;          // If != 0, the collision vertices are sorted by bin deterministically
 } ClothSimParams;
 
 /**
@@ -51,6 +130,101 @@ float calc_dihedral_angle(const float3 p1,
                           const float3 p4);
 
 
+/**
+ * Calculates the position corrections of P1 and P2 from the PBD stretch constraint of the edge [P1, P2].
+ */
+void calc_stretch_corrections(const float3 p1,
+                              const float3 p2,
+                              const float w1,
+                              const float w2,
+                              const float restLength,
+                              const float k_stretch,
+                              float3 *deltaP1,
+                              float3 *deltaP2);
+
+/**
+ * Calculates the position corrections of P1-P4 from the PBD bend constraint between the triangles
+ * [P1, P2, P3] and [P1, P4, P2].
+ */
+void calc_bend_corrections(const float3 p1,
+                           const float3 p2,
+                           const float3 p3,
+                           const float3 p4,
+                           const float w1,
+                           const float w2,
+                           const float w3,
+                           const float w4,
+                           const float restAngle,
+                           const float k_bend,
+                           float3 *deltaP1,
+                           float3 *deltaP2,
+                           float3 *deltaP3,
+                           float3 *deltaP4);
+
+/**
+ * Calculates the XPBD position corrections of P1 and P2 from the stretch constraint of the edge [P1, P2],
+ * and accumulates the constraint's Lagrange multiplier. alphaTilde is the compliance divided by dt^2.
+ */
+void calc_stretch_corrections_xpbd(const float3 p1,
+                                   const float3 p2,
+                                   const float w1,
+                                   const float w2,
+                                   const float restLength,
+                                   const float alphaTilde,
+                                   float *lambda,
+                                   float3 *deltaP1,
+                                   float3 *deltaP2);
+
+/**
+ * Calculates the XPBD position corrections of P1-P4 from the bend constraint between the triangles
+ * [P1, P2, P3] and [P1, P4, P2], and accumulates the constraint's Lagrange multiplier.
+ * alphaTilde is the compliance divided by dt^2.
+ */
+void calc_bend_corrections_xpbd(const float3 p1,
+                                const float3 p2,
+                                const float3 p3,
+                                const float3 p4,
+                                const float w1,
+                                const float w2,
+                                const float w3,
+                                const float w4,
+                                const float restAngle,
+                                const float alphaTilde,
+                                float *lambda,
+                                float3 *deltaP1,
+                                float3 *deltaP2,
+                                float3 *deltaP3,
+                                float3 *deltaP4);
+
+/**
+ * Replaces NaN components of a vector with zero.
+ */
+float3 zero_nan(float3 v);
+
+/**
+ * Clips a position to be above the ground plane.
+ */
+float3 clip_to_ground(const float3 position);
+
+/**
+ * Moves a position to the surface of every collider primitive that it is inside of, in order.
+ */
+float3 clip_to_primitives(float3 position,
+                          __constant const ColliderPrimitive *primitives,
+                          const uint numPrimitives);
+
+/**
+ * Rotates v by the unit quaternion q = [x, y, z, w].
+ */
+float3 rotate_by_quaternion(const float4 q, const float3 v);
+
+/**
+ * Reads a predicted position. When substeps are fused, the position is clipped to the ground
+ * plane on read, which replaces the separate clip_to_planes launch. The host only fuses substeps
+ * if the ground is the only collider, see ClothSimulationScene::findSubStepFusionBlocker.
+ */
+float3 read_predicted(__global const float3 *predictedPositions, const int id, const ClothSimParams params);
+
 /**
  * Custom constructor for Float3 since I had some errors with the built-in float3(x,y,z) (?!?!)
  */
@@ -71,18 +245,50 @@ void atomic_add_global_float(volatile __global float *addr, float val);
  */
 void cmpwise_atomic_add_global_float3(volatile __global float3 *addr, float3 val);
 
+/**
+ * Atomic addition of floats in local memory
+ */
+void atomic_add_local_float(volatile __local float *addr, float val);
+
+/**
+ * Component-wise atomic addition of a float3 vector in local memory
+ */
+void cmpwise_atomic_add_local_float3(volatile __local float3 *addr, float3 val);
+
 #define POSITION(vertex) Float3(vertex.position[0], vertex.position[1], vertex.position[2])
 #define ID get_global_id(0)
 
+/// The element of a work-item that runs over the compacted list of active (awake) elements
+/// if useActiveIDs != 0, otherwise over all elements
+#define ACTIVE_ID(activeIDs, useActiveIDs) ((useActiveIDs) ? (activeIDs)[ID] : ID)
+
 #define PI 3.1415926535f
 #define ONE_THIRD 0.33333f
 #define EDGE_NO_TRIANGLE -1
 
 #define clamped_acos(x) acos(clamp(x, -0.99999999f, 0.99999999f))
 
+/**
+ * Parameters that are baked into specialized variants of this program as #defines
+ * (see ClothSimParams::getDefinesCL), and otherwise read from the ClothSimParams argument.
+ * Only discrete parameters are baked in, the stiffnesses are GUI sliders and always read from params.
+ */
+#ifdef SPECIALIZED
+#define NUM_SUBSTEPS(params)    SPEC_NUM_SUBSTEPS
+#define FUSE_SUBSTEPS(params)   SPEC_FUSE_SUBSTEPS
+#define BEND_ENABLED(params)    SPEC_BEND_ENABLED
+#else
+#define NUM_SUBSTEPS(params)    (params).numSubSteps
+#define FUSE_SUBSTEPS(params)   (params).fuseSubSteps
+#define BEND_ENABLED(params)    1
+#endif
+#define K_STRETCH(params)       (params).k_stretch
+#define K_BEND(params)          (params).k_bend
+
 //#define __DEBUG__
 
-#ifdef __DEBUG__
+// specialized variants never print debug output
+#if defined(__DEBUG__) && !defined(SPECIALIZED)
 #define DBG(prefix, _float) printf("%s%f\n", prefix, _float)
 #define DBG3(prefix, vec3) printf("%s[%f, %f, %f]\n", prefix, vec3.x, vec3.y, vec3.z)
 #define DBG_IF_ID(id, prefix, _float) if (get_global_id(0) == id) printf("%s%f\n", prefix, _float)
@@ -104,7 +310,7 @@ void cmpwise_atomic_add_global_float3(volatile __global float3 *addr, float3 val
  *
  * Calculates this triangle's mass and adds one third of it to each of its vertices.
  */
-__kernel void calc_cloth_mass(__global const Vertex                 *vertices,          // 0
+__kernel void calc_cloth_mass(__global const float3                 *positions,         // 0
                               volatile __global ClothVertexData     *clothVertices,     // 1
                               __global const Triangle               *triangles,         // 2
                               __global ClothTriangleData            *clothTriangles) {  // 3
@@ -112,13 +318,9 @@ __kernel void calc_cloth_mass(__global const Vertex                 *vertices,
     const Triangle triangle = triangles[ID];
 
     // get the vertices that make up the triangle
-    const Vertex A = vertices[triangle.vertices[0]];
-    const Vertex B = vertices[triangle.vertices[1]];
-    const Vertex C = vertices[triangle.vertices[2]];
-
-    const float3 Apos = POSITION(A);
-    const float3 Bpos = POSITION(B);
-    const float3 Cpos = POSITION(C);
+    const float3 Apos = positions[triangle.vertices[0]];
+    const float3 Bpos = positions[triangle.vertices[1]];
+    const float3 Cpos = positions[triangle.vertices[2]];
 
     const float3 AB = Bpos - Apos;
     const float3 AC = Cpos - Apos;
@@ -158,19 +360,17 @@ __kernel void calc_inverse_mass(__global ClothVertexData *clothVertices) {
  *
  * Setup kernel that calculates initial edge properties [length of edge, dihedral angle between adjacent triangles)
  */
-__kernel void calc_edge_properties(__global const Vertex        *vertices,          // 0
-                                __global const Triangle      *triangles,         // 1
-                                __global Edge               *edges,             // 2
-                                __global ClothEdgeData      *clothEdges,        // 3
-                                __global ClothTriangleData  *clothTriangles) {  // 4
+__kernel void calc_edge_properties(__global const float3      *positions,         // 0
+                                   __global const Edge        *edges,             // 1
+                                   __global ClothEdgeData     *clothEdges) {      // 2
 
     const Edge thisedge = edges[ID];
 
     const int p1ID = thisedge.vertices[0];
     const int p2ID = thisedge.vertices[1];
 
-    const float3 p1 = POSITION(vertices[p1ID]);
-    const float3 p2 = POSITION(vertices[p2ID]);
+    const float3 p1 = positions[p1ID];
+    const float3 p2 = positions[p2ID];
 
     /// calc edge length
     clothEdges[ID].initialLength = length(p1 - p2);
@@ -184,176 +384,675 @@ __kernel void calc_edge_properties(__global const Vertex        *vertices,
     const int p3ID = thisedge.vertices[2];
     const int p4ID = thisedge.vertices[3];
     
-    const float3 p3 = POSITION(vertices[p3ID]);
-    const float3 p4 = POSITION(vertices[p4ID]);
+    const float3 p3 = positions[p3ID];
+    const float3 p4 = positions[p4ID];
     
     clothEdges[ID].initialDihedralAngle = calc_dihedral_angle(p1, p2, p3, p4);
 }
 
+/**
+ * (runs for every stretch constraint)
+ *
+ * Setup kernel that calculates the rest length of a stretch constraint.
+ */
+__kernel void calc_stretch_rest_lengths(__global const float3           *positions,             // 0
+                                        __global StretchConstraint      *stretchConstraints) {  // 1
+
+    const int p1ID = stretchConstraints[ID].vertices[0];
+    const int p2ID = stretchConstraints[ID].vertices[1];
+
+    stretchConstraints[ID].restLength = length(positions[p1ID] - positions[p2ID]);
+}
+
+/**
+ * (runs for every bend constraint)
+ *
+ * Setup kernel that calculates the rest dihedral angle of a bend constraint.
+ */
+__kernel void calc_bend_rest_angles(__global const float3       *positions,         // 0
+                                    __global BendConstraint     *bendConstraints) { // 1
+
+    const BendConstraint constraint = bendConstraints[ID];
+
+    bendConstraints[ID].restAngle = calc_dihedral_angle(positions[constraint.vertices[0]],
+                                                        positions[constraint.vertices[1]],
+                                                        positions[constraint.vertices[2]],
+                                                        positions[constraint.vertices[3]]);
+}
+
 ////////////  /////////////////////////////////////////////////////  ////////////
 ////////////  //////////// POSITION CORRECTION KERNELS ////////////  ////////////
 ////////////  /////////////////////////////////////////////////////  ////////////
 
 
 /**
- * (runs for every vertex)
+ * (runs for every active vertex)
  *
- * Clips vertex positions to be above the ground plane.
+ * Clips vertex positions to be outside of the collider primitives of the scene.
  */
-__kernel void clip_to_planes(__global float3 *predictedPositions) {
-    const float3 predictedPosition = predictedPositions[ID];
+__kernel void clip_to_planes(__global float3                    *predictedPositions,    // 0
+                             __global const uint                *activeVertices,        // 1
+                             const uint                         useActiveIDs,           // 2
+                             __constant const ColliderPrimitive *primitives,            // 3
+                             const uint                         numPrimitives) {        // 4
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    const float3 predictedPosition = predictedPositions[id];
     
-    const float clippedY = max(predictedPosition.y, 0.02f);
-    const float3 clippedPosition = Float3(predictedPosition.x, clippedY, predictedPosition.z);
+    const float3 clippedPosition = clip_to_primitives(predictedPosition, primitives, numPrimitives);
     
     DBG3_IF_ID(2, "predictedPosition=", predictedPosition);
-    DBG_IF_ID(2, "clippedY         =", clippedY);
     DBG3_IF_ID(2, "clippedPosition  =", clippedPosition);
     
-    predictedPositions[ID] = clippedPosition;
+    predictedPositions[id] = clippedPosition;
     
-    DBG3_IF_ID(2, "clippedPosition =", predictedPositions[ID]);
+    DBG3_IF_ID(2, "clippedPosition =", predictedPositions[id]);
 }
 
 /**
- * (runs for every edge)
+ * (runs for every active stretch constraint)
  *
- * Calculates the position correction data for an edge, and updates the position correction vectors of its
- * vertices (P1, P2) and the adjacent triangles' additional vertices (P3, P4).
- */
-__kernel void calc_position_corrections(__global const Vertex               *vertices,              // 0
-                                     __global const ClothVertexData      *clothVertices,         // 1
-                                     __global const Edge                 *edges,                 // 2
-                                     __global const ClothEdgeData        *clothEdges,            // 3
-                                     __global const Triangle             *triangles,             // 4
-                                     __global const ClothTriangleData    *clothTriangles,        // 5
-                                     __global const float3                *predictedPositions,    // 6
-                                     volatile __global float3              *positionCorrections,   // 7
-                                     const ClothSimParams              params) {               // 8
-    
+ * Calculates the position corrections of a stretch constraint and adds them to the position correction
+ * vectors of its vertices.
+ */
+__kernel void calc_stretch_position_corrections(__global const ClothVertexData      *clothVertices,         // 0
+                                                __global const StretchConstraint    *stretchConstraints,    // 1
+                                                __global const float3               *predictedPositions,    // 2
+                                                volatile __global float3            *positionCorrections,   // 3
+                                                __global const uint                 *activeConstraints,     // 4
+                                                const uint                          useActiveIDs,           // 5
+                                                const ClothSimParams                params) {              // 6
+
+    const StretchConstraint constraint = stretchConstraints[ACTIVE_ID(activeConstraints, useActiveIDs)];
+
+    const int v1ID = constraint.vertices[0];
+    const int v2ID = constraint.vertices[1];
+
+    float3 deltaP1, deltaP2;
+    calc_stretch_corrections(read_predicted(predictedPositions, v1ID, params),
+                             read_predicted(predictedPositions, v2ID, params),
+                             clothVertices[v1ID].invmass, clothVertices[v2ID].invmass,
+                             constraint.restLength, K_STRETCH(params),
+                             &deltaP1, &deltaP2);
+
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v1ID]), deltaP1);
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v2ID]), deltaP2);
+}
+
+/**
+ * (runs for every active bend constraint)
+ *
+ * Calculates the position corrections of a bend constraint and adds them to the position correction
+ * vectors of its vertices (P1, P2) and the adjacent triangles' additional vertices (P3, P4).
+ */
+__kernel void calc_bend_position_corrections(__global const ClothVertexData     *clothVertices,         // 0
+                                             __global const BendConstraint      *bendConstraints,       // 1
+                                             __global const float3              *predictedPositions,    // 2
+                                             volatile __global float3           *positionCorrections,   // 3
+                                             __global const uint                *activeConstraints,     // 4
+                                             const uint                         useActiveIDs,           // 5
+                                             const ClothSimParams               params) {              // 6
+
+    if (!BEND_ENABLED(params)) return;
+
+    const BendConstraint constraint = bendConstraints[ACTIVE_ID(activeConstraints, useActiveIDs)];
+
+    const int v1ID = constraint.vertices[0];
+    const int v2ID = constraint.vertices[1];
+    const int v3ID = constraint.vertices[2];
+    const int v4ID = constraint.vertices[3];
+
+    float3 deltaP1, deltaP2, deltaP3, deltaP4;
+    calc_bend_corrections(read_predicted(predictedPositions, v1ID, params),
+                          read_predicted(predictedPositions, v2ID, params),
+                          read_predicted(predictedPositions, v3ID, params),
+                          read_predicted(predictedPositions, v4ID, params),
+                          clothVertices[v1ID].invmass, clothVertices[v2ID].invmass,
+                          clothVertices[v3ID].invmass, clothVertices[v4ID].invmass,
+                          constraint.restAngle, K_BEND(params),
+                          &deltaP1, &deltaP2, &deltaP3, &deltaP4);
+
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v1ID]), deltaP1);
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v2ID]), deltaP2);
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v3ID]), deltaP3);
+    cmpwise_atomic_add_global_float3(&(positionCorrections[v4ID]), deltaP4);
+}
+
+/**
+ * (runs for every constraint partition, one work-group per partition)
+ *
+ * Calculates the same position corrections as calc_stretch_position_corrections and (if projectBend != 0)
+ * calc_bend_position_corrections for the constraints of a partition, with the positions of its local vertices
+ * cached in local memory and the corrections accumulated with local atomics. Every local vertex then adds its
+ * sum to the global position corrections once: interior vertices with a plain store, since no other partition
+ * moves them, and boundary/halo vertices with a global atomic.
+ */
+__kernel void calc_partition_position_corrections(__global const ClothVertexData       *clothVertices,         // 0
+                                                  __global const StretchConstraint     *stretchConstraints,    // 1
+                                                  __global const BendConstraint        *bendConstraints,       // 2
+                                                  __global const ConstraintPartition   *partitions,            // 3
+                                                  __global const uint                  *partitionVertices,     // 4
+                                                  __global const PartitionConstraint   *partitionStretch,      // 5
+                                                  __global const PartitionConstraint   *partitionBend,         // 6
+                                                  __global const float3                *predictedPositions,    // 7
+                                                  volatile __global float3             *positionCorrections,   // 8
+                                                  __local float3                       *positions,             // 9
+                                                  __local float                        *invmasses,             // 10
+                                                  volatile __local float3              *corrections,           // 11
+                                                  const uint                           projectBend,            // 12
+                                                  const ClothSimParams                 params) {               // 13
+
+    const ConstraintPartition partition = partitions[get_group_id(0)];
+    const uint localID = get_local_id(0);
+    const uint localSize = get_local_size(0);
+
+    /// load the local vertices
+    for (uint i = localID; i < partition.numVertices; i += localSize) {
+        const uint vertexID = partitionVertices[partition.vertexOffset + i];
+        positions[i] = read_predicted(predictedPositions, vertexID, params);
+        invmasses[i] = clothVertices[vertexID].invmass;
+        corrections[i] = Float3(0.0f, 0.0f, 0.0f);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /// accumulate the corrections of the partition's constraints in local memory
+    for (uint i = localID; i < partition.numStretchConstraints; i += localSize) {
+        const PartitionConstraint constraint = partitionStretch[partition.stretchOffset + i];
+        const uint v1 = constraint.localVertices[0];
+        const uint v2 = constraint.localVertices[1];
+
+        float3 deltaP1, deltaP2;
+        calc_stretch_corrections(positions[v1], positions[v2], invmasses[v1], invmasses[v2],
+                                 stretchConstraints[constraint.constraintID].restLength, K_STRETCH(params),
+                                 &deltaP1, &deltaP2);
+
+        cmpwise_atomic_add_local_float3(&(corrections[v1]), deltaP1);
+        cmpwise_atomic_add_local_float3(&(corrections[v2]), deltaP2);
+    }
+
+    if (BEND_ENABLED(params) && projectBend) {
+        for (uint i = localID; i < partition.numBendConstraints; i += localSize) {
+            const PartitionConstraint constraint = partitionBend[partition.bendOffset + i];
+            const uint v1 = constraint.localVertices[0];
+            const uint v2 = constraint.localVertices[1];
+            const uint v3 = constraint.localVertices[2];
+            const uint v4 = constraint.localVertices[3];
+
+            float3 deltaP1, deltaP2, deltaP3, deltaP4;
+            calc_bend_corrections(positions[v1], positions[v2], positions[v3], positions[v4],
+                                  invmasses[v1], invmasses[v2], invmasses[v3], invmasses[v4],
+                                  bendConstraints[constraint.constraintID].restAngle, K_BEND(params),
+                                  &deltaP1, &deltaP2, &deltaP3, &deltaP4);
+
+            cmpwise_atomic_add_local_float3(&(corrections[v1]), deltaP1);
+            cmpwise_atomic_add_local_float3(&(corrections[v2]), deltaP2);
+            cmpwise_atomic_add_local_float3(&(corrections[v3]), deltaP3);
+            cmpwise_atomic_add_local_float3(&(corrections[v4]), deltaP4);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /// add the sums to the global corrections, which correct_predictions has reset to zero
+    for (uint i = localID; i < partition.numVertices; i += localSize) {
+        const uint vertexID = partitionVertices[partition.vertexOffset + i];
+        if (i < partition.numInteriorVertices) {
+            positionCorrections[vertexID] = corrections[i];
+        } else {
+            cmpwise_atomic_add_global_float3(&(positionCorrections[vertexID]), corrections[i]);
+        }
+    }
+}
+
+/**
+ * (runs for every edge in a single color batch, launched with the batch's offset as global offset)
+ *
+ * Projects the stretch/bend constraints of an edge and writes the corrected positions directly to the
+ * predicted positions. No two edges in the same color batch share a vertex, so each batch is a
+ * conflict-free Gauss-Seidel pass that needs neither atomics nor a separate correction kernel.
+ * When substeps are fused, every read is clipped to the ground, so a vertex is clipped again before
+ * each of its colors instead of once before all colors of the substep.
+ */
+__kernel void project_constraints_colored(__global const ClothVertexData    *clothVertices,         // 0
+                                          __global const Edge               *edges,                 // 1
+                                          __global const ClothEdgeData      *clothEdges,            // 2
+                                          __global float3                   *predictedPositions,    // 3
+                                          const ClothSimParams              params) {               // 4
+
     const Edge edge                 = edges[ID];
     const ClothEdgeData clothEdge   = clothEdges[ID];
-    
+
     const int v1ID = edge.vertices[0];
     const int v2ID = edge.vertices[1];
-    
-    const ClothVertexData cv1   = clothVertices[v1ID];
-    const ClothVertexData cv2   = clothVertices[v2ID];
-    
-    float3 p1 = predictedPositions[v1ID];
-    float3 p2 = predictedPositions[v2ID];
-    
-    //////////////////////////
-    /// stretch constraint ///
-    //////////////////////////
-    
-    const float3 p2p1 = p1 - p2;
-    const float p2p1length = length(p2p1);
-    
-    const float Cstretch = p2p1length - clothEdge.initialLength;
-    const float3 gradCstretch = params.k_stretch * p2p1 / max(p2p1length, 0.1f);
-    
-    const float tmp = 1 / (cv1.invmass + cv2.invmass);
-    
-    float3 deltaP1 = -(cv1.invmass * tmp) * Cstretch * gradCstretch;
-    float3 deltaP2 =  (cv2.invmass * tmp) * Cstretch * gradCstretch;
 
-    DBG3_IF_ID(2, "p1=", p1);
-    DBG3_IF_ID(2, "p2=", p2);
-    DBG3_IF_ID(2, "p2p1=", p2p1);
-    DBG_IF_ID(2, "length(p2p1)=", p2p1length);
-    DBG_IF_ID(2, "Cstretch=", Cstretch);
-    DBG3_IF_ID(2, "gradCstretch=", gradCstretch);
-    DBG_IF_ID(2, "tmp=", tmp);
+    const float w1 = clothVertices[v1ID].invmass;
+    const float w2 = clothVertices[v2ID].invmass;
 
-    ///////////////////////
-    /// bend constraint ///
-    ///////////////////////
-    
-    if (edge.triangles[1] != EDGE_NO_TRIANGLE) {
+    float3 p1 = read_predicted(predictedPositions, v1ID, params);
+    float3 p2 = read_predicted(predictedPositions, v2ID, params);
+
+    float3 deltaP1, deltaP2;
+    calc_stretch_corrections(p1, p2, w1, w2, clothEdge.initialLength, K_STRETCH(params), &deltaP1, &deltaP2);
+    p1 += zero_nan(deltaP1);
+    p2 += zero_nan(deltaP2);
+
+    if (BEND_ENABLED(params) && edge.triangles[1] != EDGE_NO_TRIANGLE) {
         const int v3ID = edge.vertices[2];
         const int v4ID = edge.vertices[3];
-        
-        const ClothVertexData cv3   = clothVertices[v3ID];
-        const ClothVertexData cv4   = clothVertices[v4ID];
-        
-        // subtract p1 from all positions to get simpler expressions
-        p2 -= p1;
-        
-        const float3 p3 = predictedPositions[v3ID] - p1;
-        const float3 p4 = predictedPositions[v4ID] - p1;
-        p1 = Float3(0.0f, 0.0f, 0.0f);
-        
-        const float3 n1 = normalize(Cross(p2, p3));
-        const float3 n2 = normalize(Cross(p2, p4));
-        const float d = dot(n1, n2);
-        
-        const float3 q3 = (Cross(p2, n2) + Cross(n1, p2) * d) / length(Cross(p2, p3));
-        const float3 q4 = (Cross(p2, n1) + Cross(n2, p2) * d) / length(Cross(p2, p4));
-        const float3 q2 = -(Cross(p3, n2) + Cross(n1, p3) * d) / length(Cross(p2, p3)) - (Cross(p4, n1) + Cross(n2, p4) * d) / length(Cross(p2, p4));
-        const float3 q1 = - q2 - q3 - q4;
-        
-        const float denom = (cv1.invmass * pow(length(q1),2) +
-                           cv2.invmass * pow(length(q2),2) +
-                           cv3.invmass * pow(length(q3),2) +
-                           cv4.invmass * pow(length(q4),2));
-        const float nom = -sqrt(clamp(1 - pow(d, 2), 0.0f, 1.0f)) * (clamped_acos(d) - clothEdge.initialDihedralAngle);
-        const float factor = nom / max(denom, 0.00001f);
-
-        deltaP1 += params.k_bend * cv1.invmass * factor * q1;
-        deltaP2 += params.k_bend * cv2.invmass * factor * q2;
-        const float3 deltaP3 = params.k_bend * cv3.invmass * factor * q3;
-        const float3 deltaP4 = params.k_bend * cv4.invmass * factor * q4;
-
-        DBG_IF_ID(2, "initialDihedralAngle=", clothEdge.initialDihedralAngle);
-        DBG_IF_ID(2, "       dihedralAngle=", clamped_acos(d));
-        DBG3_IF_ID(2, "p1=", p1);
-        DBG3_IF_ID(2, "p2=", p2);
-        DBG3_IF_ID(2, "p3=", p3);
-        DBG3_IF_ID(2, "p4=", p4);
-        DBG3_IF_ID(2, "n1=", n1);
-        DBG3_IF_ID(2, "n2=", n2);
-        DBG_IF_ID(2, "d=", d);
-        DBG_IF_ID(2, "nom=", nom);
-        DBG_IF_ID(2, "denom=", denom);
-        DBG_IF_ID(2, "factor=", factor);
-        DBG3_IF_ID(2, "deltaP1=", deltaP1);
-        DBG3_IF_ID(2, "deltaP2=", deltaP2);
-        DBG3_IF_ID(2, "deltaP3=", deltaP3);
-        DBG3_IF_ID(2, "deltaP4=", deltaP4);
-
-        cmpwise_atomic_add_global_float3(&(positionCorrections[v3ID]), deltaP3);
-        cmpwise_atomic_add_global_float3(&(positionCorrections[v4ID]), deltaP4);
+
+        const float3 p3 = read_predicted(predictedPositions, v3ID, params);
+        const float3 p4 = read_predicted(predictedPositions, v4ID, params);
+
+        float3 deltaP3, deltaP4;
+        calc_bend_corrections(p1, p2, p3, p4,
+                              w1, w2, clothVertices[v3ID].invmass, clothVertices[v4ID].invmass,
+                              clothEdge.initialDihedralAngle, K_BEND(params),
+                              &deltaP1, &deltaP2, &deltaP3, &deltaP4);
+        p1 += zero_nan(deltaP1);
+        p2 += zero_nan(deltaP2);
+
+        predictedPositions[v3ID] = p3 + zero_nan(deltaP3);
+        predictedPositions[v4ID] = p4 + zero_nan(deltaP4);
     }
-    
-    cmpwise_atomic_add_global_float3(&(positionCorrections[v1ID]), deltaP1);
-    cmpwise_atomic_add_global_float3(&(positionCorrections[v2ID]), deltaP2);
+
+    predictedPositions[v1ID] = p1;
+    predictedPositions[v2ID] = p2;
+}
+
+/**
+ * (runs for every edge in a single color batch, launched with the batch's offset as global offset)
+ *
+ * XPBD version of project_constraints_colored. The stretch/bend constraints are compliant instead of
+ * scaled by k_stretch/k_bend, and their Lagrange multipliers are accumulated in lambdas[ID] = [stretch, bend]
+ * over the substeps of a time step. The multipliers must be zeroed at the start of every time step.
+ */
+__kernel void project_constraints_xpbd(__global const ClothVertexData   *clothVertices,         // 0
+                                       __global const Edge              *edges,                 // 1
+                                       __global const ClothEdgeData     *clothEdges,            // 2
+                                       __global float3                  *predictedPositions,    // 3
+                                       __global float2                  *lambdas,               // 4
+                                       const ClothSimParams             params) {              // 5
+
+    const Edge edge                 = edges[ID];
+    const ClothEdgeData clothEdge   = clothEdges[ID];
+
+    const int v1ID = edge.vertices[0];
+    const int v2ID = edge.vertices[1];
+
+    const float w1 = clothVertices[v1ID].invmass;
+    const float w2 = clothVertices[v2ID].invmass;
+
+    const float invDeltaTime2 = 1.0f / (params.deltaTime * params.deltaTime);
+    float2 lambda = lambdas[ID];
+
+    float3 p1 = read_predicted(predictedPositions, v1ID, params);
+    float3 p2 = read_predicted(predictedPositions, v2ID, params);
+
+    float3 deltaP1, deltaP2;
+    calc_stretch_corrections_xpbd(p1, p2, w1, w2, clothEdge.initialLength,
+                                  params.compliance_stretch * invDeltaTime2, &lambda.x, &deltaP1, &deltaP2);
+    p1 += zero_nan(deltaP1);
+    p2 += zero_nan(deltaP2);
+
+    if (BEND_ENABLED(params) && edge.triangles[1] != EDGE_NO_TRIANGLE) {
+        const int v3ID = edge.vertices[2];
+        const int v4ID = edge.vertices[3];
+
+        const float3 p3 = read_predicted(predictedPositions, v3ID, params);
+        const float3 p4 = read_predicted(predictedPositions, v4ID, params);
+
+        float3 deltaP3, deltaP4;
+        calc_bend_corrections_xpbd(p1, p2, p3, p4,
+                                   w1, w2, clothVertices[v3ID].invmass, clothVertices[v4ID].invmass,
+                                   clothEdge.initialDihedralAngle, params.compliance_bend * invDeltaTime2,
+                                   &lambda.y, &deltaP1, &deltaP2, &deltaP3, &deltaP4);
+        p1 += zero_nan(deltaP1);
+        p2 += zero_nan(deltaP2);
+
+        predictedPositions[v3ID] = p3 + zero_nan(deltaP3);
+        predictedPositions[v4ID] = p4 + zero_nan(deltaP4);
+    }
+
+    predictedPositions[v1ID] = p1;
+    predictedPositions[v2ID] = p2;
+    lambdas[ID] = lambda;
 }
 
 /**
- *  (runs for every vertex)
+ * (runs for every edge)
  *
- *  Corrects position predictions by adding the position corrections to the predicted positions.
+ * First phase of the gather-based Jacobi solver. Calculates the position corrections of an edge's
+ * stretch/bend constraints and writes them to the edge's own slots [4 * ID, 4 * ID + 3] in the order
+ * [P1, P2, P3, P4]. The P3/P4 slots of edges that only belong to a single triangle are left unused.
+ */
+__kernel void calc_constraint_deltas(__global const ClothVertexData     *clothVertices,         // 0
+                                     __global const Edge                *edges,                 // 1
+                                     __global const ClothEdgeData       *clothEdges,            // 2
+                                     __global const float3              *predictedPositions,    // 3
+                                     __global float3                    *constraintDeltas,      // 4
+                                     const ClothSimParams               params) {               // 5
+
+    const Edge edge                 = edges[ID];
+    const ClothEdgeData clothEdge   = clothEdges[ID];
+
+    const int v1ID = edge.vertices[0];
+    const int v2ID = edge.vertices[1];
+
+    const float w1 = clothVertices[v1ID].invmass;
+    const float w2 = clothVertices[v2ID].invmass;
+
+    const float3 p1 = read_predicted(predictedPositions, v1ID, params);
+    const float3 p2 = read_predicted(predictedPositions, v2ID, params);
+
+    float3 deltaP1, deltaP2;
+    calc_stretch_corrections(p1, p2, w1, w2, clothEdge.initialLength, K_STRETCH(params), &deltaP1, &deltaP2);
+
+    // the slots of the opposite vertices are gathered even if bending is disabled, so they are always written
+    if (edge.triangles[1] != EDGE_NO_TRIANGLE) {
+        float3 deltaP3 = (float3)(0.0f, 0.0f, 0.0f);
+        float3 deltaP4 = (float3)(0.0f, 0.0f, 0.0f);
+
+        if (BEND_ENABLED(params)) {
+            const int v3ID = edge.vertices[2];
+            const int v4ID = edge.vertices[3];
+
+            float3 bendP1, bendP2;
+            calc_bend_corrections(p1, p2,
+                                  read_predicted(predictedPositions, v3ID, params),
+                                  read_predicted(predictedPositions, v4ID, params),
+                                  w1, w2, clothVertices[v3ID].invmass, clothVertices[v4ID].invmass,
+                                  clothEdge.initialDihedralAngle, K_BEND(params),
+                                  &bendP1, &bendP2, &deltaP3, &deltaP4);
+            deltaP1 += bendP1;
+            deltaP2 += bendP2;
+        }
+
+        constraintDeltas[4 * ID + 2] = deltaP3;
+        constraintDeltas[4 * ID + 3] = deltaP4;
+    }
+
+    constraintDeltas[4 * ID + 0] = deltaP1;
+    constraintDeltas[4 * ID + 1] = deltaP2;
+}
+
+/**
+ * (runs for every vertex)
+ *
+ * Second phase of the gather-based Jacobi solver. Sums the constraint delta slots of this vertex,
+ * always in the same order, and adds the sum to the predicted position.
+ */
+__kernel void gather_position_corrections(__global const uint       *vertexSlotOffsets,     // 0
+                                          __global const uint       *vertexSlots,           // 1
+                                          __global const float3     *constraintDeltas,      // 2
+                                          __global float3           *predictedPositions,    // 3
+                                          const ClothSimParams      params) {               // 4
+
+    const uint slotsBegin = vertexSlotOffsets[ID];
+    const uint slotsEnd = vertexSlotOffsets[ID + 1];
+
+    float3 correction = Float3(0.0f, 0.0f, 0.0f);
+    for (uint i = slotsBegin; i < slotsEnd; ++i) {
+        correction += constraintDeltas[vertexSlots[i]];
+    }
+
+    predictedPositions[ID] = read_predicted(predictedPositions, ID, params) + zero_nan(correction);
+}
+
+/**
+ * (runs as a single work-group per cloth, work-group k solves cloth k)
+ *
+ * Runs every substep of the colored Gauss-Seidel solver for a small cloth in local memory. The predicted
+ * positions and inverse masses (and the edge rest data, if cacheRestData != 0) are loaded once, every color
+ * batch is separated by a barrier instead of a kernel launch, and the positions are written back once.
+ * The local buffers are indexed relative to the cloth's first vertex, and to the cloth's first edge in
+ * color order.
+ */
+__kernel void solve_cloth_local(__global const ClothVertexData  *clothVertices,         // 0
+                                __global const Edge             *edges,                 // 1
+                                __global const ClothEdgeData    *clothEdges,            // 2
+                                __global const ClothRange       *clothRanges,           // 3
+                                __global const uint             *edgeBatchOffsets,      // 4
+                                const uint                      numCloths,              // 5
+                                const uint                      numEdgeColors,          // 6
+                                __global float3                 *predictedPositions,    // 7
+                                __local float3                  *positions,             // 8
+                                __local float                   *invmasses,             // 9
+                                __local float                   *restLengths,           // 10
+                                __local float                   *restAngles,            // 11
+                                const uint                      cacheRestData,          // 12
+                                const ClothSimParams            params,                 // 13
+                                __constant const ColliderPrimitive *primitives,         // 14
+                                const uint                      numPrimitives) {        // 15
+
+    const uint cloth = get_group_id(0);
+    const uint localID = get_local_id(0);
+    const uint localSize = get_local_size(0);
+
+    const ClothRange range = clothRanges[cloth];
+    const uint vertexOffset = range.vertexOffset;
+    const uint numVertices = range.numVertices;
+
+    /// load the cloth state into local memory
+    for (uint vertexID = localID; vertexID < numVertices; vertexID += localSize) {
+        positions[vertexID] = predictedPositions[vertexOffset + vertexID];
+        invmasses[vertexID] = clothVertices[vertexOffset + vertexID].invmass;
+    }
+    if (cacheRestData) {
+        uint localEdgeOffset = 0;
+        for (uint color = 0; color < numEdgeColors; ++color) {
+            const uint batchBegin = edgeBatchOffsets[color * (numCloths + 1) + cloth];
+            const uint batchEnd = edgeBatchOffsets[color * (numCloths + 1) + cloth + 1];
+
+            for (uint edgeID = batchBegin + localID; edgeID < batchEnd; edgeID += localSize) {
+                restLengths[localEdgeOffset + edgeID - batchBegin] = clothEdges[edgeID].initialLength;
+                restAngles[localEdgeOffset + edgeID - batchBegin] = clothEdges[edgeID].initialDihedralAngle;
+            }
+            localEdgeOffset += batchEnd - batchBegin;
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (uint iter = 0; iter < NUM_SUBSTEPS(params); ++iter) {
+        /// clip cloth vertices to be outside of the collider primitives
+        for (uint vertexID = localID; vertexID < numVertices; vertexID += localSize) {
+            positions[vertexID] = clip_to_primitives(positions[vertexID], primitives, numPrimitives);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /// project the constraints of one edge color batch at a time
+        uint localEdgeOffset = 0;
+        for (uint color = 0; color < numEdgeColors; ++color) {
+            const uint batchBegin = edgeBatchOffsets[color * (numCloths + 1) + cloth];
+            const uint batchEnd = edgeBatchOffsets[color * (numCloths + 1) + cloth + 1];
+
+            for (uint edgeID = batchBegin + localID; edgeID < batchEnd; edgeID += localSize) {
+                const Edge edge = edges[edgeID];
+                const uint localEdgeID = localEdgeOffset + edgeID - batchBegin;
+                const float restLength = cacheRestData ? restLengths[localEdgeID] : clothEdges[edgeID].initialLength;
+                const float restAngle = cacheRestData ? restAngles[localEdgeID] : clothEdges[edgeID].initialDihedralAngle;
+
+                const int v1ID = edge.vertices[0] - vertexOffset;
+                const int v2ID = edge.vertices[1] - vertexOffset;
+
+                float3 p1 = positions[v1ID];
+                float3 p2 = positions[v2ID];
+
+                float3 deltaP1, deltaP2;
+                calc_stretch_corrections(p1, p2, invmasses[v1ID], invmasses[v2ID], restLength, K_STRETCH(params),
+                                         &deltaP1, &deltaP2);
+                p1 += zero_nan(deltaP1);
+                p2 += zero_nan(deltaP2);
+
+                if (BEND_ENABLED(params) && edge.triangles[1] != EDGE_NO_TRIANGLE) {
+                    const int v3ID = edge.vertices[2] - vertexOffset;
+                    const int v4ID = edge.vertices[3] - vertexOffset;
+
+                    const float3 p3 = positions[v3ID];
+                    const float3 p4 = positions[v4ID];
+
+                    float3 deltaP3, deltaP4;
+                    calc_bend_corrections(p1, p2, p3, p4,
+                                          invmasses[v1ID], invmasses[v2ID], invmasses[v3ID], invmasses[v4ID],
+                                          restAngle, K_BEND(params),
+                                          &deltaP1, &deltaP2, &deltaP3, &deltaP4);
+                    p1 += zero_nan(deltaP1);
+                    p2 += zero_nan(deltaP2);
+
+                    positions[v3ID] = p3 + zero_nan(deltaP3);
+                    positions[v4ID] = p4 + zero_nan(deltaP4);
+                }
+
+                positions[v1ID] = p1;
+                positions[v2ID] = p2;
+            }
+            localEdgeOffset += batchEnd - batchBegin;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+    }
+
+    /// write the solved positions back
+    for (uint vertexID = localID; vertexID < numVertices; vertexID += localSize) {
+        predictedPositions[vertexOffset + vertexID] = positions[vertexID];
+    }
+}
+
+/**
+ * (runs for every stretch constraint, rounded up to whole work-groups of a power-of-two size)
+ *
+ * Reduces the relative stretch |length - restLength| / restLength of the predicted positions into
+ * violation[0] = max and violation[1] = sum of squares, which must be zeroed before the launch. Each
+ * work-group reduces in local memory and does one atomic per result. The max is combined with an
+ * integer atomic_max, since non-negative floats are ordered the same way as their bit patterns.
+ */
+__kernel void calc_constraint_violation(__global const StretchConstraint    *stretchConstraints,    // 0
+                                        __global const float3               *predictedPositions,    // 1
+                                        const uint                          numConstraints,         // 2
+                                        __local float                       *localMax,              // 3
+                                        __local float                       *localSumSq,            // 4
+                                        volatile __global float             *violation,             // 5
+                                        const ClothSimParams                params) {              // 6
+
+    const uint localID = get_local_id(0);
+
+    float strain = 0.0f;
+    if (ID < numConstraints) {
+        const StretchConstraint constraint = stretchConstraints[ID];
+        const float3 p1 = read_predicted(predictedPositions, constraint.vertices[0], params);
+        const float3 p2 = read_predicted(predictedPositions, constraint.vertices[1], params);
+        strain = fabs(length(p1 - p2) - constraint.restLength) / max(constraint.restLength, 0.00001f);
+    }
+
+    localMax[localID] = strain;
+    localSumSq[localID] = strain * strain;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (uint offset = get_local_size(0) / 2; offset > 0; offset >>= 1) {
+        if (localID < offset) {
+            localMax[localID] = max(localMax[localID], localMax[localID + offset]);
+            localSumSq[localID] += localSumSq[localID + offset];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (localID == 0) {
+        atomic_max((volatile __global uint *) &violation[0], as_uint(localMax[0]));
+        atomic_add_global_float(&violation[1], localSumSq[0]);
+    }
+}
+
+/**
+ *  (runs for every active vertex)
+ *
+ *  Corrects position predictions by adding the (over-relaxed) position corrections to the predicted positions.
+ *  With Chebyshev acceleration the result is extrapolated from the predictions of the previous substep:
+ *      x(k+1) = omega * (x(k) + overRelaxation * correction - x(k-1)) + x(k-1)
+ *  where omega is the Chebyshev weight of the current substep (1 = no extrapolation).
  */
 __kernel void correct_predictions(__global float3      *positionCorrections,   // 0
-                               __global float3      *predictedPositions) {  // 1
+                               __global float3      *predictedPositions,    // 1
+                               __global float3      *previousPredicted,     // 2
+                               const float          omega,                  // 3
+                               __global const uint  *activeVertices,        // 4
+                               const uint           useActiveIDs,           // 5
+                               const ClothSimParams params) {               // 6
 
-    const float3 predicted = predictedPositions[ID];
-    float3 correction = positionCorrections[ID];
-    if (isnan(correction.x)) correction.x = 0.0f;
-    if (isnan(correction.y)) correction.y = 0.0f;
-    if (isnan(correction.z)) correction.z = 0.0f;
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    const float3 predicted = read_predicted(predictedPositions, id, params);
+    const float3 correction = zero_nan(positionCorrections[id]);
     
-    const float3 corrected = predicted + corrected;
+    float3 corrected = predicted + params.overRelaxation * correction;
+
+    if (params.useChebyshev) {
+        const float3 previous = previousPredicted[id];
+        if (omega != 1.0f) {
+            corrected = omega * (corrected - previous) + previous;
+        }
+        previousPredicted[id] = predicted;
+    }
 
-    predictedPositions[ID] += correction;
+    predictedPositions[id] = corrected;
 
     DBG3_IF_ID(2, "predicted =", predicted);
     DBG3_IF_ID(2, "correction=", correction);
     DBG3_IF_ID(2, "corrected =", corrected);
 
     // don't forget to reset position correction when we're done!
-    positionCorrections[ID] = Float3(0.0f, 0.0f, 0.0f);
+    positionCorrections[id] = Float3(0.0f, 0.0f, 0.0f);
+}
+
+/**
+ *  (runs for every vertex of a coarse multigrid level)
+ *
+ *  Restricts the predicted positions to a coarse level (by injection, the coarse vertices are a subset
+ *  of the finer level's vertices), so that the displacement of the coarse level can be prolonged later.
+ */
+__kernel void restrict_positions(__global const uint      *levelVertices,         // 0
+                                 __global const float3    *predictedPositions,    // 1
+                                 __global float3          *levelPositions,        // 2
+                                 const ClothSimParams     params) {               // 3
+
+    levelPositions[ID] = read_predicted(predictedPositions, levelVertices[ID], params);
+}
+
+/**
+ *  (runs for every vertex of a coarse multigrid level)
+ *
+ *  Like correct_predictions, but only for the vertices of a coarse level.
+ */
+__kernel void correct_level_predictions(__global const uint    *levelVertices,         // 0
+                                        __global float3        *positionCorrections,   // 1
+                                        __global float3        *predictedPositions,    // 2
+                                        const ClothSimParams   params) {               // 3
+
+    const uint vertexID = levelVertices[ID];
+
+    predictedPositions[vertexID] = read_predicted(predictedPositions, vertexID, params)
+                                   + zero_nan(positionCorrections[vertexID]);
+    positionCorrections[vertexID] = Float3(0.0f, 0.0f, 0.0f);
+}
+
+/**
+ *  (runs for every prolongation stencil of a coarse multigrid level)
+ *
+ *  Prolongs the displacement of a coarse level since restrict_positions to a vertex of the finer
+ *  level that is not part of the coarse level, by interpolating the displacements of its coarse neighbours.
+ */
+__kernel void prolong_corrections(__global const ClothVertexData       *clothVertices,         // 0
+                                  __global const ProlongationStencil   *stencils,              // 1
+                                  __global const uint                  *levelVertices,         // 2
+                                  __global const float3                *levelPositions,        // 3
+                                  __global float3                      *predictedPositions) {  // 4
+
+    const ProlongationStencil stencil = stencils[ID];
+    if (clothVertices[stencil.vertexID].invmass == 0.0f) return;
+
+    float3 correction = Float3(0.0f, 0.0f, 0.0f);
+    for (uint i = 0; i < 4; ++i) {
+        const int parent = stencil.parents[i];
+        if (parent == -1) break;
+
+        correction += stencil.weights[i] * (predictedPositions[levelVertices[parent]] - levelPositions[parent]);
+    }
+
+    predictedPositions[stencil.vertexID] += zero_nan(correction);
 }
 
 float calc_dihedral_angle(const float3 p1,
@@ -365,6 +1064,246 @@ float calc_dihedral_angle(const float3 p1,
     return clamped_acos(dot(n1, n2));
 }
 
+void calc_stretch_corrections(const float3 p1,
+                              const float3 p2,
+                              const float w1,
+                              const float w2,
+                              const float restLength,
+                              const float k_stretch,
+                              float3 *deltaP1,
+                              float3 *deltaP2) {
+    const float3 p2p1 = p1 - p2;
+    const float p2p1length = length(p2p1);
+
+    const float Cstretch = p2p1length - restLength;
+    const float3 gradCstretch = k_stretch * p2p1 / max(p2p1length, 0.1f);
+
+    // both vertices pinned gives w1 + w2 = 0, in which case both corrections are zero
+    const float tmp = 1 / max(w1 + w2, 0.00001f);
+
+    *deltaP1 = -(w1 * tmp) * Cstretch * gradCstretch;
+    *deltaP2 =  (w2 * tmp) * Cstretch * gradCstretch;
+
+    DBG3_IF_ID(2, "p1=", p1);
+    DBG3_IF_ID(2, "p2=", p2);
+    DBG3_IF_ID(2, "p2p1=", p2p1);
+    DBG_IF_ID(2, "length(p2p1)=", p2p1length);
+    DBG_IF_ID(2, "Cstretch=", Cstretch);
+    DBG3_IF_ID(2, "gradCstretch=", gradCstretch);
+    DBG_IF_ID(2, "tmp=", tmp);
+}
+
+void calc_bend_corrections(const float3 p1,
+                           const float3 p2,
+                           const float3 p3,
+                           const float3 p4,
+                           const float w1,
+                           const float w2,
+                           const float w3,
+                           const float w4,
+                           const float restAngle,
+                           const float k_bend,
+                           float3 *deltaP1,
+                           float3 *deltaP2,
+                           float3 *deltaP3,
+                           float3 *deltaP4) {
+    // subtract p1 from all positions to get simpler expressions
+    const float3 p2_ = p2 - p1;
+    const float3 p3_ = p3 - p1;
+    const float3 p4_ = p4 - p1;
+
+    const float3 n1 = normalize(Cross(p2_, p3_));
+    const float3 n2 = normalize(Cross(p2_, p4_));
+    const float d = dot(n1, n2);
+
+    const float3 q3 = (Cross(p2_, n2) + Cross(n1, p2_) * d) / length(Cross(p2_, p3_));
+    const float3 q4 = (Cross(p2_, n1) + Cross(n2, p2_) * d) / length(Cross(p2_, p4_));
+    const float3 q2 = -(Cross(p3_, n2) + Cross(n1, p3_) * d) / length(Cross(p2_, p3_)) - (Cross(p4_, n1) + Cross(n2, p4_) * d) / length(Cross(p2_, p4_));
+    const float3 q1 = - q2 - q3 - q4;
+
+    const float denom = (w1 * pow(length(q1),2) +
+                         w2 * pow(length(q2),2) +
+                         w3 * pow(length(q3),2) +
+                         w4 * pow(length(q4),2));
+    const float nom = -sqrt(clamp(1 - pow(d, 2), 0.0f, 1.0f)) * (clamped_acos(d) - restAngle);
+    const float factor = nom / max(denom, 0.00001f);
+
+    *deltaP1 = k_bend * w1 * factor * q1;
+    *deltaP2 = k_bend * w2 * factor * q2;
+    *deltaP3 = k_bend * w3 * factor * q3;
+    *deltaP4 = k_bend * w4 * factor * q4;
+
+    DBG_IF_ID(2, "initialDihedralAngle=", restAngle);
+    DBG_IF_ID(2, "       dihedralAngle=", clamped_acos(d));
+    DBG3_IF_ID(2, "p2=", p2_);
+    DBG3_IF_ID(2, "p3=", p3_);
+    DBG3_IF_ID(2, "p4=", p4_);
+    DBG3_IF_ID(2, "n1=", n1);
+    DBG3_IF_ID(2, "n2=", n2);
+    DBG_IF_ID(2, "d=", d);
+    DBG_IF_ID(2, "nom=", nom);
+    DBG_IF_ID(2, "denom=", denom);
+    DBG_IF_ID(2, "factor=", factor);
+}
+
+void calc_stretch_corrections_xpbd(const float3 p1,
+                                   const float3 p2,
+                                   const float w1,
+                                   const float w2,
+                                   const float restLength,
+                                   const float alphaTilde,
+                                   float *lambda,
+                                   float3 *deltaP1,
+                                   float3 *deltaP2) {
+    const float3 p2p1 = p1 - p2;
+    const float p2p1length = length(p2p1);
+
+    // gradient of C with respect to P1, the gradient with respect to P2 is its negation
+    const float3 gradCstretch = p2p1 / max(p2p1length, 0.00001f);
+    const float Cstretch = p2p1length - restLength;
+
+    const float deltaLambda = (-Cstretch - alphaTilde * (*lambda)) / max(w1 + w2 + alphaTilde, 0.00001f);
+    *lambda += deltaLambda;
+
+    *deltaP1 =  (w1 * deltaLambda) * gradCstretch;
+    *deltaP2 = -(w2 * deltaLambda) * gradCstretch;
+}
+
+void calc_bend_corrections_xpbd(const float3 p1,
+                                const float3 p2,
+                                const float3 p3,
+                                const float3 p4,
+                                const float w1,
+                                const float w2,
+                                const float w3,
+                                const float w4,
+                                const float restAngle,
+                                const float alphaTilde,
+                                float *lambda,
+                                float3 *deltaP1,
+                                float3 *deltaP2,
+                                float3 *deltaP3,
+                                float3 *deltaP4) {
+    // same gradients as calc_bend_corrections, grad(C)_i = q_i / sqrt(1 - d^2)
+    const float3 p2_ = p2 - p1;
+    const float3 p3_ = p3 - p1;
+    const float3 p4_ = p4 - p1;
+
+    const float3 n1 = normalize(Cross(p2_, p3_));
+    const float3 n2 = normalize(Cross(p2_, p4_));
+    const float d = dot(n1, n2);
+
+    const float3 q3 = (Cross(p2_, n2) + Cross(n1, p2_) * d) / length(Cross(p2_, p3_));
+    const float3 q4 = (Cross(p2_, n1) + Cross(n2, p2_) * d) / length(Cross(p2_, p4_));
+    const float3 q2 = -(Cross(p3_, n2) + Cross(n1, p3_) * d) / length(Cross(p2_, p3_)) - (Cross(p4_, n1) + Cross(n2, p4_) * d) / length(Cross(p2_, p4_));
+    const float3 q1 = - q2 - q3 - q4;
+
+    const float sumWQ2 = (w1 * pow(length(q1),2) +
+                          w2 * pow(length(q2),2) +
+                          w3 * pow(length(q3),2) +
+                          w4 * pow(length(q4),2));
+    const float sin2 = clamp(1 - pow(d, 2), 0.0f, 1.0f);
+    const float Cbend = clamped_acos(d) - restAngle;
+
+    // both the multiplier update and the corrections are multiplied through by (1 - d^2), so that
+    // flat configurations (d = 1) give zero corrections instead of dividing by zero
+    const float nom = -Cbend - alphaTilde * (*lambda);
+    const float denom = max(sumWQ2 + alphaTilde * sin2, 0.00001f);
+    *lambda += sin2 * nom / denom;
+
+    const float factor = sqrt(sin2) * nom / denom;
+    *deltaP1 = w1 * factor * q1;
+    *deltaP2 = w2 * factor * q2;
+    *deltaP3 = w3 * factor * q3;
+    *deltaP4 = w4 * factor * q4;
+}
+
+float3 zero_nan(float3 v) {
+    if (isnan(v.x)) v.x = 0.0f;
+    if (isnan(v.y)) v.y = 0.0f;
+    if (isnan(v.z)) v.z = 0.0f;
+    return v;
+}
+
+float3 clip_to_ground(const float3 position) {
+    return Float3(position.x, max(position.y, 0.02f), position.z);
+}
+
+float3 clip_to_primitives(float3 position,
+                          __constant const ColliderPrimitive *primitives,
+                          const uint numPrimitives) {
+    for (uint i = 0; i < numPrimitives; ++i) {
+        const ColliderPrimitive primitive = primitives[i];
+        const float3 a = Float3(primitive.a[0], primitive.a[1], primitive.a[2]);
+        const float3 b = Float3(primitive.b[0], primitive.b[1], primitive.b[2]);
+
+        switch (primitive.type) {
+            case COLLIDER_PLANE:
+            {
+                /// a is the unit normal, b.x the offset of the plane along it
+                const float distance = dot(a, position) - b.x;
+                if (distance < 0.0f) position -= distance * a;
+                break;
+            }
+
+            case COLLIDER_SPHERE:
+            case COLLIDER_CAPSULE:
+            {
+                /// a sphere is a capsule whose ends are both at its center
+                float3 center = a;
+                if (primitive.type == COLLIDER_CAPSULE) {
+                    const float3 axis = b - a;
+                    const float axisLength2 = dot(axis, axis);
+                    const float t = axisLength2 > 0.0f ? clamp(dot(position - a, axis) / axisLength2, 0.0f, 1.0f)
+                                                       : 0.0f;
+                    center = a + t * axis;
+                }
+
+                const float3 offset = position - center;
+                const float distance = length(offset);
+                if (distance < primitive.radius && distance > 0.0f) {
+                    position = center + offset * (primitive.radius / distance);
+                }
+                break;
+            }
+
+            case COLLIDER_BOX:
+            {
+                /// push out through the nearest face, in the box's frame
+                const float4 q = (float4)(primitive.rotation[0], primitive.rotation[1],
+                                          primitive.rotation[2], primitive.rotation[3]);
+                float3 local = rotate_by_quaternion((float4)(-q.xyz, q.w), position - a);
+                const float3 penetration = b - fabs(local);
+                if (penetration.x > 0.0f && penetration.y > 0.0f && penetration.z > 0.0f) {
+                    if (penetration.x <= penetration.y && penetration.x <= penetration.z) {
+                        local.x = copysign(b.x, local.x);
+                    } else if (penetration.y <= penetration.z) {
+                        local.y = copysign(b.y, local.y);
+                    } else {
+                        local.z = copysign(b.z, local.z);
+                    }
+                    position = a + rotate_by_quaternion(q, local);
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return position;
+}
+
+float3 rotate_by_quaternion(const float4 q, const float3 v) {
+    const float3 t = 2.0f * Cross(q.xyz, v);
+    return v + q.w * t + Cross(q.xyz, t);
+}
+
+float3 read_predicted(__global const float3 *predictedPositions, const int id, const ClothSimParams params) {
+    const float3 predicted = predictedPositions[id];
+    return FUSE_SUBSTEPS(params) ? clip_to_ground(predicted) : predicted;
+}
+
 float3 Float3(float x, float y, float z) {
     float3 vec;
     vec.x = x;
@@ -403,3 +1342,25 @@ void cmpwise_atomic_add_global_float3(volatile __global float3 *addr, float3 val
     atomic_add_global_float(&(faddr[1]), val.y);
     atomic_add_global_float(&(faddr[2]), val.z);
 }
+
+void atomic_add_local_float(volatile __local float *addr, float val) {
+    union{
+        unsigned int u32;
+        float        f32;
+    } next, expected, current;
+    current.f32    = *addr;
+    do{
+        expected.f32 = current.f32;
+        next.f32     = expected.f32 + val;
+        current.u32  = atomic_cmpxchg( (volatile __local unsigned int *)addr,
+                                       expected.u32, next.u32);
+    } while( current.u32 != expected.u32 );
+}
+
+void cmpwise_atomic_add_local_float3(volatile __local float3 *addr, float3 val) {
+    volatile __local float *faddr = (__local float *) addr;
+
+    atomic_add_local_float(&(faddr[0]), val.x);
+    atomic_add_local_float(&(faddr[1]), val.y);
+    atomic_add_local_float(&(faddr[2]), val.z);
+}
@@ -1,41 +1,81 @@
 #pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable
 
+/**
+ * OpenCL representation of extra cloth vertex data. Matches the memory
+ * layout of the ClothVertexData struct in src/geometry/geometry.hpp
+ */
+typedef struct def_ClothVertexData {
+    uint vertexID; // don't know if this is needed
+    float mass;
+    float invmass;
+} ClothVertexData;
+
 #define ID get_global_id(0)
-/// Pre-processor defines that specify grid parameters
-/// halfDims[Z,Y,Z]         // The dimensions/2 of the grid
-/// binSize                 // The side-length of a bin
-/// binCount[Z,Y,Z]         // The number of bins in each dimension
-/// binCount                // The total number of bins in the grid
+
+/// The element of a work-item that runs over the compacted list of active (awake) elements
+/// if useActiveIDs != 0, otherwise over all elements
+#define ACTIVE_ID(activeIDs, useActiveIDs) ((useActiveIDs) ? (activeIDs)[ID] : ID)
+/**
+ * OpenCL representation of the collision grid. Matches the memory
+ * layout of the Grid struct in src/simulation/Grid.hpp
+ */
+typedef struct def_Grid {
+    float origin[3];        // Lower corner of a bounded grid
+    float binSize;          // The side-length of a bin
+    uint binCount3D[3];     // The number of bins in each dimension of a bounded grid
+    uint binCount;          // The total number of bins, or the size of the hash table (a power of two)
+    uint isHashed;          // If != 0, the grid is unbounded and its cells are hashed into binCount buckets
+} Grid;
 
 /**
- * Calculates a corresponding 3D-index in the uniform grid based on a position. ("hashing")
+ * Calculates the 3D-index of the cell that contains a position. Positions outside of a bounded
+ * grid are clamped into its border bins, the cells of a hashed grid may have negative indices.
  * @param position The position
  * @return The 3D-index
  */
-inline uint3 getBinID_3D(const float3 position) {
-    float3 tmp = (position + float3(halfDimsX, halfDimsY, halfDimsZ)) / binSize;
-    uint3 indices = convert_uint3(floor(tmp));
-    return clamp(indices, uint3(0, 0, 0), uint3(binCountX-1, binCountY-1, binCountZ-1));
+inline int3 getBinID_3D(const float3 position, const Grid grid) {
+    const float3 origin = (float3)(grid.origin[0], grid.origin[1], grid.origin[2]);
+    const int3 indices = convert_int3(floor((position - origin) / grid.binSize));
+    if (grid.isHashed) return indices;
+
+    return clamp(indices, (int3)(0, 0, 0),
+                 (int3)(grid.binCount3D[0] - 1, grid.binCount3D[1] - 1, grid.binCount3D[2] - 1));
 }
 
 /**
- * Computes the 1D-index into the linearized uniform grid arrays from a 3D-index.
+ * Computes the 1D-index into the linearized grid arrays from a 3D-index. The cells of a hashed grid are hashed
+ * into its buckets (Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable
+ * Objects", 2003), cells that are far apart can share a bucket, so the particles of a bucket must be filtered
+ * by their cell.
  * @param binID_3D The 3D-index
  * @return The 1D-index
  */
-inline uint getBinID(const uint3 binID_3D) {
-    return binID_3D.x + binCountX * binID_3D.y + binCountX * binCountY * binID_3D.z;
+inline uint getBinID(const int3 binID_3D, const Grid grid) {
+    if (grid.isHashed) {
+        const uint3 cell = as_uint3(binID_3D);
+        return ((cell.x * 73856093u) ^ (cell.y * 19349663u) ^ (cell.z * 83492791u)) & (grid.binCount - 1);
+    }
+
+    return binID_3D.x + grid.binCount3D[0] * (binID_3D.y + grid.binCount3D[1] * binID_3D.z);
 }
 
 /**
  * Inserts a particle in the grid and increments corresponding counters.
+ *
+ * Also writes the bin and the ID of the particle to index sortOffset + ID - get_global_offset(0) of sortKeys and
+ * sortIDs, so that the ranges of particles that are inserted one after another are packed in increasing order
+ * of their IDs, for a stable sort by bin that doesn't depend on the order of the atomic increments.
  */
-__kernel void insert_particles(__global const float3    *predictedPositions,
-                               __global volatile uint   *particleBinID,
-                               __global volatile uint   *particleInBinID,
-                               __global volatile uint   *binCounts) {
+__kernel void insert_particles(__global const float3    *predictedPositions,    // 0
+                               __global volatile uint   *particleBinID,         // 1
+                               __global volatile uint   *particleInBinID,       // 2
+                               __global volatile uint   *binCounts,             // 3
+                               const Grid               grid,                   // 4
+                               __global uint            *sortKeys,              // 5
+                               __global uint            *sortIDs,               // 6
+                               const uint               sortOffset) {           // 7
     // Compute the 1D bin index of this particle
-    const uint binID = getBinID(getBinID_3D(predictedPositions[ID]));
+    const uint binID = getBinID(getBinID_3D(predictedPositions[ID], grid), grid);
 
     // Store the bin index in the particle data
     particleBinID[ID] = binID;
@@ -45,21 +85,136 @@ __kernel void insert_particles(__global const float3    *predictedPositions,
     // Also atomically increment the particle count of the bin, since this kernel is run in parallel for
     // every particle at the same time.
     particleInBinID[ID] = atomic_inc(&binCounts[binID]);
+
+    const uint sortID = sortOffset + ID - get_global_offset(0);
+    sortKeys[sortID] = binID;
+    sortIDs[sortID] = ID;
 }
 
+/// The starting index of every bin into the new particle arrays is the exclusive prefix sum of
+/// the bin counts, see kernels/scan.cl and util::PrefixScan.
+///
+/// The order of the particles within a bin follows the atomic increments of insert_particles, which differs
+/// from run to run. For the same order on every run, sortKeys and sortIDs are sorted by a stable radix sort
+/// instead (util::RadixSort), into the particles ordered by bin and ID within each bin, and the predicted
+/// positions are gathered in that order (util::RadixSort::enqueueGather).
+
 /**
- * Calculates the starting index into the new particle array for a
- * bin, using prefix sum of bin counts.
+ * (runs for every vertex)
+ *
+ * Writes the ID and predicted position of every particle to its index in bin order, so that the particles
+ * of bin b are sortedParticleIDs[binStartID[b]] to sortedParticleIDs[binStartID[b] + binCounts[b] - 1]. The
+ * particle state itself stays in place, since the cloth constraints refer to the particles by their IDs.
  */
-__kernel void compute_bin_start_ID(__global const uint  *binCounts,
-                                   __global uint        *binStartID) {
-    uint count = 0;
-    for (uint prior_id = 0; prior_id < ID; ++prior_id) {
-        // Increment this bin's starting index with the count of a previous bin
-        count = count + binCounts[prior_id];
+__kernel void sort_particles(__global const float3  *predictedPositions,    // 0
+                             __global const uint    *particleBinID,         // 1
+                             __global const uint    *particleInBinID,       // 2
+                             __global const uint    *binStartID,            // 3
+                             __global uint          *sortedParticleIDs,     // 4
+                             __global float3        *sortedPositions) {     // 5
+
+    const uint sortedID = binStartID[particleBinID[ID]] + particleInBinID[ID];
+    sortedParticleIDs[sortedID] = ID;
+    sortedPositions[sortedID] = predictedPositions[ID];
+}
+
+/**
+ * (runs for every active vertex)
+ *
+ * Pushes a particle out of every particle in the 27 bins around it that is closer than collisionDistance,
+ * which must be at most binSize, split by the inverse masses. The corrections of all contacts are averaged.
+ * Two particles only collide if clothPairs[cloth * numCloths + otherCloth] != 0 (self-collisions on the
+ * diagonal), and particles of the same cloth that are closer than collisionDistance at rest are neighbours
+ * on the cloth and don't collide. The other particles are read from the sorted copy of the predicted
+ * positions, so that every work-item only writes its own particle.
+ *
+ * With a hashed grid, the particles of a bucket that lie in another cell than the visited one are skipped,
+ * so that neither a hash collision with a far away cell nor two neighbour cells that share a bucket make a
+ * particle collide twice with the same other particle.
+ *
+ * If wakeClusters != 0, the sleep cluster of every other particle in contact gets an infinite speed for this
+ * frame, see calc_cluster_speeds in kernels/predict_positions.cl, so that the host wakes up a sleeping cluster
+ * that an awake particle ran into. The sleeping particles themselves aren't active and find no contacts.
+ */
+__kernel void collide_particles(__global const ClothVertexData  *clothVertices,         // 0
+                                __global const float3           *restPositions,         // 1
+                                __global const uint             *binCounts,             // 2
+                                __global const uint             *binStartID,            // 3
+                                __global const uint             *sortedParticleIDs,     // 4
+                                __global const float3           *sortedPositions,       // 5
+                                __global float3                 *predictedPositions,    // 6
+                                __global const uint             *activeVertices,        // 7
+                                const uint                      useActiveIDs,           // 8
+                                const float                     collisionDistance,      // 9
+                                __global const uint             *vertexClothIDs,        // 10
+                                __global const uint             *clothPairs,            // 11
+                                const uint                      numCloths,              // 12
+                                const Grid                      grid,                   // 13
+                                __global const uint             *vertexClusters,        // 14
+                                volatile __global uint          *clusterSpeeds,         // 15
+                                const uint                      wakeClusters) {         // 16
+
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    const float w = clothVertices[id].invmass;
+    if (w == 0.0f) return;
+
+    // the row of the cloth pairs that this particle can collide in
+    const uint cloth = vertexClothIDs[id];
+    __global const uint *collidesWith = clothPairs + cloth * numCloths;
+
+    const float3 position = predictedPositions[id];
+    const float3 restPosition = restPositions[id];
+    const int3 binID_3D = getBinID_3D(position, grid);
+    const float distanceSq = collisionDistance * collisionDistance;
+
+    float3 correction = (float3)(0.0f, 0.0f, 0.0f);
+    uint numContacts = 0;
+
+    int3 lower = binID_3D - 1;
+    int3 upper = binID_3D + 1;
+    if (!grid.isHashed) {
+        lower = max(lower, (int3)(0, 0, 0));
+        upper = min(upper, (int3)(grid.binCount3D[0] - 1, grid.binCount3D[1] - 1, grid.binCount3D[2] - 1));
+    }
+
+    for (int z = lower.z; z <= upper.z; ++z) {
+        for (int y = lower.y; y <= upper.y; ++y) {
+            for (int x = lower.x; x <= upper.x; ++x) {
+                const int3 cell = (int3)(x, y, z);
+                const uint binID = getBinID(cell, grid);
+                const uint begin = binStartID[binID];
+                const uint end = begin + binCounts[binID];
+
+                for (uint i = begin; i < end; ++i) {
+                    const float3 otherPosition = sortedPositions[i];
+                    if (grid.isHashed && any(getBinID_3D(otherPosition, grid) != cell)) continue;
+                    const float3 delta = position - otherPosition;
+                    const float lengthSq = dot(delta, delta);
+                    if (lengthSq >= distanceSq || lengthSq == 0.0f) continue;
+
+                    const uint otherID = sortedParticleIDs[i];
+                    const uint otherCloth = vertexClothIDs[otherID];
+                    if (!collidesWith[otherCloth]) continue;
+
+                    const float3 restDelta = restPosition - restPositions[otherID];
+                    if (otherCloth == cloth && dot(restDelta, restDelta) < distanceSq) continue;
+
+                    const float length = sqrt(lengthSq);
+                    const float wOther = clothVertices[otherID].invmass;
+                    correction += w / (w + wOther) * (collisionDistance - length) / length * delta;
+                    ++numContacts;
+
+                    if (wakeClusters) {
+                        atomic_max(&clusterSpeeds[vertexClusters[otherID]], as_uint(INFINITY));
+                    }
+                }
+            }
+        }
     }
 
-    binStartID[ID] = count;
+    if (numContacts > 0) {
+        predictedPositions[id] = position + correction / (float) numContacts;
+    }
 }
 
 /**
@@ -21,6 +21,10 @@ typedef struct def_ClothVertexData {
 
 #define ID get_global_id(0)
 
+/// The element of a work-item that runs over the compacted list of active (awake) elements
+/// if useActiveIDs != 0, otherwise over all elements
+#define ACTIVE_ID(activeIDs, useActiveIDs) ((useActiveIDs) ? (activeIDs)[ID] : ID)
+
 inline float3 Float3(float x, float y, float z) {
     float3 vec;
     vec.x = x;
@@ -50,12 +54,12 @@ inline float3 Float3(float x, float y, float z) {
  *
  * Calculates the distance of each vertex to a world-space line/ray.
  */
-__kernel void calc_dist_to_line(__global const Vertex   *vertices,          // 0
+__kernel void calc_dist_to_line(__global const float3   *positions,         // 0
                                 __global float          *distances,         // 1
                                 const float3            lineOrigin,         // 2
                                 const float3            lineDirection) {    // 3
 
-    float3 position = POSITION(vertices[ID]);
+    float3 position = positions[ID];
     position.y = -position.y;
 
     const float3 relposition = position - lineOrigin;
@@ -68,23 +72,26 @@ __kernel void calc_dist_to_line(__global const Vertex   *vertices,          // 0
 }
 
 /**
- * (runs for every vertex)
+ * (runs for every active vertex)
  *
- * Calculates the distance of each vertex to a world-space line/ray.
+ * Applies gravity to velocities and predicts positions based on an Euler timestep
  */
 __kernel void predict_positions(__global float3         *predictedPositions, // 0
                                 __global float3         *velocities,         // 1
-                                __global const Vertex   *vertices,           // 2
+                                __global const float3   *positions,          // 2
                                 __global const ClothVertexData *clothVertices, // 3
-                                const float             deltaTime) {         // 4
+                                const float             deltaTime,           // 4
+                                __global const uint     *activeVertices,     // 5
+                                const uint              useActiveIDs) {      // 6
 
-    const float3 origposition = POSITION(vertices[ID]);
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    const float3 origposition = positions[id];
     DBG3_IF_ID(3, "origposition=", origposition);
     
-    const float factor = clothVertices[ID].invmass * clothVertices[ID].mass;
+    const float factor = clothVertices[id].invmass * clothVertices[id].mass;
     DBG_IF_ID(3, "factor=", factor);
     
-    float3 velocity = velocities[ID];
+    float3 velocity = velocities[id];
     DBG3_IF_ID(3, "origvelocity=", velocity);
     
     velocity.y -= factor * deltaTime * 9.82f;
@@ -94,30 +101,162 @@ __kernel void predict_positions(__global float3         *predictedPositions, //
         
     const float3 newposition = origposition + factor * deltaTime * velocity;
     
-    predictedPositions[ID] = newposition;
+    predictedPositions[id] = newposition;
 }
 
 /**
- * (runs for every vertex)
+ * (runs for every active vertex)
  *
- * Applies gravity to velocities and predicts positions based on an Euler timestep
+ * Updates velocities from the corrected predictions and sets the positions to the predictions
  */
 __kernel void set_positions_to_predicted(__global const float3  *predictedPositions,        // 0
-                                         __global Vertex        *vertices,          // 1
+                                         __global float3        *positions,         // 1
                                          __global float3        *velocities,        // 2
-                                         const float            deltaTime) {      // 3
+                                         const float            deltaTime,          // 3
+                                         __global const uint    *activeVertices,    // 4
+                                         const uint             useActiveIDs) {     // 5
     
-    const float3 origposition = POSITION(vertices[ID]);
-    const float3 newposition = predictedPositions[ID];
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    const float3 origposition = positions[id];
+    const float3 newposition = predictedPositions[id];
     const float3 velocity = (newposition - origposition) / deltaTime;
     
     DBG3_IF_ID(3, "origposition=", origposition);
     DBG3_IF_ID(3, "velocity    =", velocity);
     DBG3_IF_ID(3, "newposition =", newposition);
     
-    velocities[ID] = velocity;
-    
-    vertices[ID].position[0] = newposition.x;
-    vertices[ID].position[1] = newposition.y;
-    vertices[ID].position[2] = newposition.z;
+    velocities[id] = velocity;
+    positions[id] = newposition;
+}
+
+/**
+ * (runs for every active vertex)
+ *
+ * Reduces the max speed of the vertices of every sleep cluster. Speeds are non-negative,
+ * so their bit patterns are ordered like unsigned integers.
+ */
+__kernel void calc_cluster_speeds(__global const float3   *velocities,        // 0
+                                  __global const uint     *vertexClusters,    // 1
+                                  volatile __global uint  *clusterSpeeds,     // 2
+                                  __global const uint     *activeVertices,    // 3
+                                  const uint              useActiveIDs) {     // 4
+
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+
+    atomic_max(&clusterSpeeds[vertexClusters[id]], as_uint(length(velocities[id])));
+}
+
+/**
+ * (runs for every sleep cluster)
+ *
+ * Counts the consecutive frames in which every vertex of a sleep cluster was slower than
+ * sleepSpeed, and resets the cluster's speed for the next frame. Sleeping clusters have no
+ * active vertices, so they stay calm.
+ */
+__kernel void count_calm_frames(__global uint     *clusterSpeeds,     // 0
+                                __global uint     *calmFrames,        // 1
+                                const float       sleepSpeed) {       // 2
+
+    const uint frames = calmFrames[ID];
+    calmFrames[ID] = (as_float(clusterSpeeds[ID]) < sleepSpeed) ? min(frames, 0xFFFFFFFEu) + 1 : 0;
+    clusterSpeeds[ID] = 0;
+}
+
+/**
+ * Maps a float to a uint with the same order, so that floats of any sign can be reduced with
+ * atomic_min and atomic_max. Positive floats get the sign bit set, negative floats are inverted.
+ */
+inline uint as_ordered_uint(const float value) {
+    const uint bits = as_uint(value);
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+/**
+ * Merges a bounding box into 8 uints [min x, min y, min z, max speed, max x, max y, max z, unused],
+ * with the coordinates of lower and upper mapped by as_ordered_uint and the speed in upper.w.
+ */
+inline void atomic_merge_bounds(volatile __global uint *bounds, const uint4 lower, const uint4 upper) {
+    atomic_min(&bounds[0], lower.x);
+    atomic_min(&bounds[1], lower.y);
+    atomic_min(&bounds[2], lower.z);
+    atomic_max(&bounds[3], upper.w);
+    atomic_max(&bounds[4], upper.x);
+    atomic_max(&bounds[5], upper.y);
+    atomic_max(&bounds[6], upper.z);
+}
+
+/**
+ * (runs for every vertex, the global size is rounded up to a multiple of the power-of-two work-group size)
+ *
+ * Reduces the bounding box and the max speed of every cloth into 8 uints per cloth,
+ * [min x, min y, min z, max speed, max x, max y, max z, unused], where the coordinates are
+ * mapped by as_ordered_uint, and those of the whole scene into the 8 uints after the last cloth.
+ * The bounds must be reset to [0xFFFFFFFF x 3, 0 x 5] before the launch.
+ *
+ * Every work-group reduces its vertices in local memory first, so that a work-group within a single cloth
+ * only merges one box into the bounds of its cloth and of the scene. The few work-groups that span two
+ * or more cloths merge the box of every vertex into its cloth instead.
+ */
+__kernel void calc_cloth_bounds(__global const float3   *positions,         // 0
+                                __global const float3   *velocities,        // 1
+                                __global const uint     *vertexClothIDs,    // 2
+                                volatile __global uint  *clothBounds,       // 3
+                                const uint              numVertices,        // 4
+                                const uint              numCloths,          // 5
+                                __local uint4           *localLower,        // 6
+                                __local uint4           *localUpper) {      // 7
+
+    const uint localID = get_local_id(0);
+    const uint groupBegin = get_group_id(0) * get_local_size(0);
+    const uint groupEnd = min(groupBegin + (uint) get_local_size(0), numVertices);
+    const uint firstCloth = vertexClothIDs[groupBegin];
+    const bool isSingleCloth = firstCloth == vertexClothIDs[groupEnd - 1];
+
+    uint4 lower = (uint4)(0xFFFFFFFFu);
+    uint4 upper = (uint4)(0u);
+    if (ID < numVertices) {
+        const float3 position = positions[ID];
+        lower.xyz = (uint3)(as_ordered_uint(position.x), as_ordered_uint(position.y), as_ordered_uint(position.z));
+        upper = (uint4)(lower.xyz, as_uint(length(velocities[ID])));
+
+        if (!isSingleCloth) {
+            atomic_merge_bounds(clothBounds + 8 * vertexClothIDs[ID], lower, upper);
+        }
+    }
+
+    localLower[localID] = lower;
+    localUpper[localID] = upper;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (uint offset = get_local_size(0) / 2; offset > 0; offset >>= 1) {
+        if (localID < offset) {
+            localLower[localID] = min(localLower[localID], localLower[localID + offset]);
+            localUpper[localID] = max(localUpper[localID], localUpper[localID + offset]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (localID == 0) {
+        if (isSingleCloth) {
+            atomic_merge_bounds(clothBounds + 8 * firstCloth, localLower[0], localUpper[0]);
+        }
+        atomic_merge_bounds(clothBounds + 8 * numCloths, localLower[0], localUpper[0]);
+    }
+}
+
+/**
+ * (runs for every vertex of a single cloth)
+ *
+ * Copies the simulated positions of a cloth from the shared position buffer into its render vertices.
+ * Only needs to run once per rendered frame.
+ */
+__kernel void copy_positions_to_vertices(__global const float3  *positions,         // 0
+                                         __global Vertex        *vertices,          // 1
+                                         const uint             vertexOffset) {     // 2
+
+    const float3 position = positions[vertexOffset + ID];
+
+    vertices[ID].position[0] = position.x;
+    vertices[ID].position[1] = position.y;
+    vertices[ID].position[2] = position.z;
 }
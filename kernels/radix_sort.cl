@@ -0,0 +1,152 @@
+#define ID get_global_id(0)
+
+/// Number of key bits that are sorted per pass, and the number of digits per pass
+#define RADIX_BITS 4
+#define RADIX 16
+
+/**
+ * Exclusive scan of one value per work-item over the work-group (Hillis-Steele, which is fine for a
+ * single work-group). temp must hold 2 * get_local_size(0) elements.
+ * @param total Is set to the sum of the values of the work-group
+ */
+inline uint scan_local(const uint value, __local uint *temp, uint *total) {
+    const uint localID = get_local_id(0);
+    const uint size = get_local_size(0);
+
+    // the two halves of temp are read and written alternately
+    uint in = 0, out = size;
+    temp[localID] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (uint offset = 1; offset < size; offset <<= 1) {
+        uint sum = temp[in + localID];
+        if (localID >= offset) sum += temp[in + localID - offset];
+        temp[out + localID] = sum;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        const uint tmp = in;
+        in = out;
+        out = tmp;
+    }
+
+    *total = temp[in + size - 1];
+    const uint inclusive = temp[in + localID];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    return inclusive - value;
+}
+
+/**
+ * (runs for every element, rounded up to whole work-groups)
+ *
+ * Stably sorts each work-group's block of key-value pairs by the digit (keys >> shift) & (RADIX - 1), with
+ * RADIX_BITS 1-bit splits in local memory. Writes the sorted blocks, the number of elements of every digit per
+ * block to digitCounts[digit * numGroups + group] (digit-major, so that its exclusive scan is the first output
+ * index of every digit of every block) and the first index of every digit within its block to
+ * localDigitStarts[group * RADIX + digit]. Elements past the end get the largest key and end up last.
+ */
+__kernel void sort_blocks(__global const uint   *keysIn,            // 0
+                          __global const uint   *valuesIn,          // 1
+                          __global uint         *blockKeys,         // 2
+                          __global uint         *blockValues,       // 3
+                          __global uint         *digitCounts,       // 4
+                          __global uint         *localDigitStarts,  // 5
+                          const uint            numElements,        // 6
+                          const uint            shift,              // 7
+                          __local uint          *temp,              // 8
+                          __local uint          *localKeys,         // 9
+                          __local uint          *localValues,       // 10
+                          __local uint          *digitStarts,       // 11
+                          __local uint          *digitEnds) {       // 12
+
+    const uint localID = get_local_id(0);
+    const uint group = get_group_id(0);
+    const uint blockBegin = group * get_local_size(0);
+    const uint numValid = min((uint) get_local_size(0), numElements - blockBegin);
+
+    uint key = ID < numElements ? keysIn[ID] : 0xFFFFFFFFu;
+    uint value = ID < numElements ? valuesIn[ID] : 0;
+
+    if (localID < RADIX) {
+        digitStarts[localID] = 0;
+        digitEnds[localID] = 0;
+    }
+
+    /// every split moves the elements with a 0 bit before the ones with a 1 bit, keeping their order
+    for (uint bit = 0; bit < RADIX_BITS; ++bit) {
+        const uint isSet = (key >> (shift + bit)) & 1u;
+
+        uint numUnset;
+        const uint unsetBefore = scan_local(1u - isSet, temp, &numUnset);
+        const uint position = isSet ? numUnset + (localID - unsetBefore) : unsetBefore;
+
+        localKeys[position] = key;
+        localValues[position] = value;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        key = localKeys[localID];
+        value = localValues[localID];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    /// the block is sorted by digit, so every digit is a run that starts and ends where the digit changes
+    if (localID < numValid) {
+        const uint digit = (key >> shift) & (RADIX - 1);
+        if (localID == 0 || ((localKeys[localID - 1] >> shift) & (RADIX - 1)) != digit) {
+            digitStarts[digit] = localID;
+        }
+        if (localID == numValid - 1 || ((localKeys[localID + 1] >> shift) & (RADIX - 1)) != digit) {
+            digitEnds[digit] = localID + 1;
+        }
+
+        blockKeys[ID] = key;
+        blockValues[ID] = value;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (localID < RADIX) {
+        digitCounts[localID * get_num_groups(0) + group] = digitEnds[localID] - digitStarts[localID];
+        localDigitStarts[group * RADIX + localID] = digitStarts[localID];
+    }
+}
+
+/**
+ * (runs for every element, rounded up to whole work-groups of the same size as sort_blocks)
+ *
+ * Moves every element of the sorted blocks to its output index, the first output index of its digit and
+ * block (the exclusive scan of digitCounts) plus its index within the run of the digit in the block.
+ */
+__kernel void scatter_blocks(__global const uint    *blockKeys,         // 0
+                             __global const uint    *blockValues,       // 1
+                             __global const uint    *digitOffsets,      // 2
+                             __global const uint    *localDigitStarts,  // 3
+                             __global uint          *keysOut,           // 4
+                             __global uint          *valuesOut,         // 5
+                             const uint             numElements,        // 6
+                             const uint             shift) {            // 7
+
+    if (ID >= numElements) return;
+
+    const uint group = get_group_id(0);
+    const uint key = blockKeys[ID];
+    const uint digit = (key >> shift) & (RADIX - 1);
+    const uint index = digitOffsets[digit * get_num_groups(0) + group]
+                       + get_local_id(0) - localDigitStarts[group * RADIX + digit];
+
+    keysOut[index] = key;
+    valuesOut[index] = blockValues[ID];
+}
+
+/**
+ * (runs for every uint of the output)
+ *
+ * Gathers elements of wordsPerElement uints each, element i of output is element permutation[i] of input. The
+ * values of a sort of element IDs are such a permutation, so it applies to any buffer indexed by the IDs.
+ */
+__kernel void gather(__global const uint    *input,             // 0
+                     __global const uint    *permutation,       // 1
+                     __global uint          *output,            // 2
+                     const uint             wordsPerElement) {  // 3
+
+    const uint element = ID / wordsPerElement;
+    output[ID] = input[permutation[element] * wordsPerElement + ID - element * wordsPerElement];
+}
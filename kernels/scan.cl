@@ -0,0 +1,84 @@
+#define ID get_global_id(0)
+
+/// Local memory is padded by one element per NUM_BANKS elements, so that the strided accesses of the
+/// up- and down-sweep fall into different banks. M. Harris et al., "Parallel Prefix Sum (Scan) with CUDA",
+/// GPU Gems 3, chapter 39.
+#define LOG_NUM_BANKS 5
+#define CONFLICT_FREE_OFFSET(i) ((i) >> LOG_NUM_BANKS)
+
+/**
+ * (runs for 2 * get_local_size(0) elements per work-group, the local size must be a power of two)
+ *
+ * Work-efficient (Blelloch) exclusive scan of each block of 2 * get_local_size(0) elements, in O(n) additions.
+ * Writes the sum of the elements of block b to blockSums[b], which are scanned in turn and added back to the
+ * blocks by add_block_offsets. input and output may be the same buffer. temp must hold
+ * 2 * get_local_size(0) + CONFLICT_FREE_OFFSET(2 * get_local_size(0) - 1) elements.
+ */
+__kernel void scan_blocks(__global const uint   *input,         // 0
+                          __global uint         *output,        // 1
+                          __global uint         *blockSums,     // 2
+                          const uint            numElements,    // 3
+                          __local uint          *temp) {        // 4
+
+    const uint localID = get_local_id(0);
+    const uint blockSize = 2 * get_local_size(0);
+    const uint blockOffset = get_group_id(0) * blockSize;
+
+    // every work-item loads two elements, elements past the end count as 0
+    const uint ai = localID;
+    const uint bi = localID + get_local_size(0);
+    temp[ai + CONFLICT_FREE_OFFSET(ai)] = blockOffset + ai < numElements ? input[blockOffset + ai] : 0;
+    temp[bi + CONFLICT_FREE_OFFSET(bi)] = blockOffset + bi < numElements ? input[blockOffset + bi] : 0;
+
+    // up-sweep, builds the partial sums of a balanced tree in place
+    uint offset = 1;
+    for (uint d = blockSize >> 1; d > 0; d >>= 1) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (localID < d) {
+            uint a = offset * (2 * localID + 1) - 1;
+            uint b = offset * (2 * localID + 2) - 1;
+            a += CONFLICT_FREE_OFFSET(a);
+            b += CONFLICT_FREE_OFFSET(b);
+            temp[b] += temp[a];
+        }
+        offset <<= 1;
+    }
+
+    // the root holds the sum of the block
+    if (localID == 0) {
+        const uint root = blockSize - 1 + CONFLICT_FREE_OFFSET(blockSize - 1);
+        blockSums[get_group_id(0)] = temp[root];
+        temp[root] = 0;
+    }
+
+    // down-sweep, passes the sum of everything to the left of a node down to its children
+    for (uint d = 1; d < blockSize; d <<= 1) {
+        offset >>= 1;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (localID < d) {
+            uint a = offset * (2 * localID + 1) - 1;
+            uint b = offset * (2 * localID + 2) - 1;
+            a += CONFLICT_FREE_OFFSET(a);
+            b += CONFLICT_FREE_OFFSET(b);
+            const uint left = temp[a];
+            temp[a] = temp[b];
+            temp[b] += left;
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (blockOffset + ai < numElements) output[blockOffset + ai] = temp[ai + CONFLICT_FREE_OFFSET(ai)];
+    if (blockOffset + bi < numElements) output[blockOffset + bi] = temp[bi + CONFLICT_FREE_OFFSET(bi)];
+}
+
+/**
+ * (runs for every element of the second and later blocks, i.e. with a global offset of blockSize)
+ *
+ * Adds the exclusive scan of the block sums of scan_blocks to the elements of each block.
+ */
+__kernel void add_block_offsets(__global uint           *output,        // 0
+                                __global const uint     *blockOffsets,  // 1
+                                const uint              blockSize) {    // 2
+
+    output[ID] += blockOffsets[ID / blockSize];
+}
@@ -0,0 +1,82 @@
+/**
+ * OpenCL representation of a static collider. Matches the memory
+ * layout of the SdfCollider struct in src/simulation/geometry.hpp
+ */
+typedef struct def_SdfCollider {
+    float origin[3];        // World position of the first sample
+    float cellSize;         // Distance between two samples
+    uint numBricks[3];
+    uint brickTableOffset;  // Of the collider's bricks in the shared brick table
+} SdfCollider;
+
+#define ID get_global_id(0)
+
+/// The element of a work-item that runs over the compacted list of active (awake) elements
+/// if useActiveIDs != 0, otherwise over all elements
+#define ACTIVE_ID(activeIDs, useActiveIDs) ((useActiveIDs) ? (activeIDs)[ID] : ID)
+
+/// Must match SignedDistanceField::BRICK_SIZE and EMPTY_BRICK in src/geometry/SignedDistanceField.hpp
+#define BRICK_SIZE 8
+#define BRICK_SAMPLES (BRICK_SIZE + 1)
+#define EMPTY_BRICK 0xFFFFFFFFu
+
+/**
+ * (runs for every active vertex)
+ *
+ * Pushes the vertex out of every collider that it is closer to than surfaceDistance, along the gradient of the
+ * collider's signed distance field. The distance and the gradient both come from a single trilinear lookup of
+ * the 8 samples around the vertex, so the cost only depends on the number of colliders and not on their
+ * triangles. Vertices outside a collider's stored bricks are farther than its band from the surface.
+ */
+__kernel void collide_sdfs(__global float3              *predictedPositions,    // 0
+                           __global const SdfCollider   *colliders,             // 1
+                           __global const uint          *brickTable,            // 2
+                           __global const float         *brickSamples,          // 3
+                           const uint                   numColliders,           // 4
+                           const float                  surfaceDistance,        // 5
+                           __global const uint          *activeVertices,        // 6
+                           const uint                   useActiveIDs) {         // 7
+
+    const uint id = ACTIVE_ID(activeVertices, useActiveIDs);
+    float3 position = predictedPositions[id];
+
+    for (uint c = 0; c < numColliders; ++c) {
+        const SdfCollider collider = colliders[c];
+        const float3 origin = (float3)(collider.origin[0], collider.origin[1], collider.origin[2]);
+        const int3 numBricks = (int3)(collider.numBricks[0], collider.numBricks[1], collider.numBricks[2]);
+
+        /// the position in cells, the samples are at the corners of the cells
+        const float3 local = (position - origin) / collider.cellSize;
+        const int3 cell = convert_int3(floor(local));
+        if (any(cell < (int3)(0, 0, 0)) || any(cell >= numBricks * BRICK_SIZE)) continue;
+
+        const int3 brick = cell / BRICK_SIZE;
+        const uint brickID = brickTable[collider.brickTableOffset
+                                        + brick.x + numBricks.x * (brick.y + numBricks.y * brick.z)];
+        if (brickID == EMPTY_BRICK) continue;
+
+        const int3 s = cell - brick * BRICK_SIZE;
+        const float3 f = local - floor(local);
+        __global const float *samples = brickSamples + brickID * BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES;
+#define SAMPLE(dx, dy, dz) samples[((s.z + (dz)) * BRICK_SAMPLES + s.y + (dy)) * BRICK_SAMPLES + s.x + (dx)]
+        const float d000 = SAMPLE(0, 0, 0), d100 = SAMPLE(1, 0, 0), d010 = SAMPLE(0, 1, 0), d110 = SAMPLE(1, 1, 0);
+        const float d001 = SAMPLE(0, 0, 1), d101 = SAMPLE(1, 0, 1), d011 = SAMPLE(0, 1, 1), d111 = SAMPLE(1, 1, 1);
+#undef SAMPLE
+
+        const float distance = mix(mix(mix(d000, d100, f.x), mix(d010, d110, f.x), f.y),
+                                   mix(mix(d001, d101, f.x), mix(d011, d111, f.x), f.y), f.z);
+        if (distance >= surfaceDistance) continue;
+
+        /// the gradient of the trilinear interpolation, from the same samples
+        const float3 gradient = (float3)(
+                mix(mix(d100 - d000, d110 - d010, f.y), mix(d101 - d001, d111 - d011, f.y), f.z),
+                mix(mix(d010 - d000, d110 - d100, f.x), mix(d011 - d001, d111 - d101, f.x), f.z),
+                mix(mix(d001 - d000, d101 - d100, f.x), mix(d011 - d010, d111 - d110, f.x), f.y));
+        const float gradientLength = length(gradient);
+        if (gradientLength == 0.0f) continue;
+
+        position += gradient / gradientLength * (surfaceDistance - distance);
+    }
+
+    predictedPositions[id] = position;
+}
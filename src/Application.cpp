@@ -91,7 +91,8 @@ namespace clgl {
         mContext = OCL_CHECK(cl::Context({mDevice}, properties, NULL, NULL, CL_ERROR));
 
         //create queue to which we will push commands for the device.
-        mQueue = OCL_CHECK(cl::CommandQueue(mContext, mDevice, 0, CL_ERROR));
+        //profiling is enabled for the per-stage timings of the scenes
+        mQueue = OCL_CHECK(cl::CommandQueue(mContext, mDevice, CL_QUEUE_PROFILING_ENABLE, CL_ERROR));
 
         return true;
     }
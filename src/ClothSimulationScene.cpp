@@ -1,7 +1,11 @@
 #include "ClothSimulationScene.hpp"
 #include "SceneSetup.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 
 #include <util/OCL_CALL.hpp>
 #include <util/math_util.hpp>
@@ -15,42 +19,111 @@
 #include <glm/ext.hpp>
 #include <OpenCL/opencl.h>
 
-#define ENQUEUE(kernelptr, clothptr, what) \
-        OCL_CALL(mQueue.enqueueNDRangeKernel(*kernelptr, cl::NullRange, \
-cl::NDRange(clothptr->what()), cl::NullRange));
+#define ENQUEUE_RANGE(kernelptr, offset, count) { \
+        ++mNumKernelLaunches; \
+        OCL_CALL(mQueue.enqueueNDRangeKernel(*kernelptr, cl::NDRange(offset), \
+cl::NDRange(count), cl::NullRange)); }
 
-#define ENQUEUE_VERTICES(kernelptr, clothptr)   ENQUEUE(kernelptr, clothptr, numVertices)
-#define ENQUEUE_EDGES(kernelptr, clothptr)      ENQUEUE(kernelptr, clothptr, numEdges)
-#define ENQUEUE_TRIANGLES(kernelptr, clothptr)  ENQUEUE(kernelptr, clothptr, numTriangles)
+#define ENQUEUE(kernelptr, meshptr, what) ENQUEUE_RANGE(kernelptr, 0, meshptr->what())
+
+/// meshptr is either a single mesh or the ClothArena of all cloths
+#define ENQUEUE_VERTICES(kernelptr, meshptr)   ENQUEUE(kernelptr, meshptr, numVertices)
+#define ENQUEUE_EDGES(kernelptr, meshptr)      ENQUEUE(kernelptr, meshptr, numEdges)
+#define ENQUEUE_TRIANGLES(kernelptr, meshptr)  ENQUEUE(kernelptr, meshptr, numTriangles)
+
+#define ENQUEUE_STRETCH_CONSTRAINTS(kernelptr, arenaptr) ENQUEUE(kernelptr, arenaptr, numStretchConstraints)
+#define ENQUEUE_BEND_CONSTRAINTS(kernelptr, arenaptr)    ENQUEUE(kernelptr, arenaptr, numBendConstraints)
+
+/// runs over the compacted active elements of mArena while any sleep cluster is asleep, otherwise over all
+/// elements. what is Vertices, StretchConstraints or BendConstraints
+#define ENQUEUE_ACTIVE(kernelptr, what) { \
+        const unsigned long count = mIsAnyClusterAsleep ? mArena->numActive##what() : mArena->num##what(); \
+        if (count > 0) ENQUEUE_RANGE(kernelptr, 0, count); }
 
 namespace pbd {
+    /**
+     * Inverse of as_ordered_uint in kernels/predict_positions.cl.
+     */
+    static float FromOrderedUint(const cl_uint bits) {
+        const cl_uint floatBits = (bits & 0x80000000u) ? bits & 0x7FFFFFFFu : ~bits;
+        float value;
+        std::memcpy(&value, &floatBits, sizeof(float));
+        return value;
+    }
+
+    /**
+     * Returns the summed device time of the events in ms, and clears them.
+     */
+    static double SumEventTimes(std::vector<cl::Event> &events) {
+        cl_ulong nanoseconds = 0;
+        for (const auto &event : events) {
+            nanoseconds += event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                           - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        }
+        events.clear();
+        return 1e-6 * nanoseconds;
+    }
+
+    /**
+     * Converts an analytic collider of a setup to its device representation.
+     * @return false if the type of the collider is unknown
+     */
+    static bool ToColliderPrimitive(const ColliderConfig &config, ColliderPrimitive &primitive) {
+        const glm::quat rotation(config.orientation);
+        glm::vec3 a = config.position, b = config.end;
+        primitive.radius = config.radius;
+
+        if (config.type == "PLANE") {
+            primitive.type = ColliderType::PLANE;
+            a = glm::normalize(config.normal);
+            b = glm::vec3(glm::dot(a, config.position), 0.0f, 0.0f);
+        } else if (config.type == "SPHERE") {
+            primitive.type = ColliderType::SPHERE;
+        } else if (config.type == "CAPSULE") {
+            primitive.type = ColliderType::CAPSULE;
+        } else if (config.type == "BOX") {
+            primitive.type = ColliderType::BOX;
+            b = config.halfExtents;
+        } else {
+            return false;
+        }
+
+        for (int axis = 0; axis < 3; ++axis) {
+            primitive.a[axis] = a[axis];
+            primitive.b[axis] = b[axis];
+        }
+        primitive.rotation[0] = rotation.x;
+        primitive.rotation[1] = rotation.y;
+        primitive.rotation[2] = rotation.z;
+        primitive.rotation[3] = rotation.w;
+        return true;
+    }
+
     ClothSimulationScene::ClothSimulationScene(cl::Context &context, cl::Device &device, cl::CommandQueue &queue)
             : BaseScene(context, device, queue) {
         mCurrentSetupFile = RESOURCEPATH("setups/simple.json");
+        mSpecializeKernels = true;
+        mFastMath = false;
         mParams = ClothSimParams::ReadFromFile(RESOURCEPATH("params/default.json"));
+        mStepParams = mParams.getStepParams();
         createCamera();
         createAxis();
         loadMarker();
-        loadKernels();
-
-        mGridCL = util::make_unique<pbd::Grid>();
-        mGridCL->halfDimensions = {1.0f, 1.0f, 1.0f, 0.0f};
-        mGridCL->binSize = 0.1f;
-        mGridCL->binCount3D = {16, 20, 20, 0};
-        mGridCL->binCount = 16 * 20 * 20;
-
-        OCL_ERROR;
 
-        OCL_CHECK(mBinCountCL = util::make_unique<cl::Buffer>(mContext,
-                                                              CL_MEM_READ_WRITE,
-                                                              sizeof(cl_uint) * mGridCL->binCount,
-                                                              (void*)0, CL_ERROR));
-        OCL_CHECK(mBinStartIDCL = util::make_unique<cl::Buffer>(mContext,
-                                                                CL_MEM_READ_WRITE,
-                                                                sizeof(cl_uint) * mGridCL->binCount,
-                                                                (void*)0, CL_ERROR));
+        loadKernels();
 
         mIsGrabbingCloth = false;
+        mNumKernelLaunches = 0;
+        mSubStepsUsed = 0;
+        mViolation[0] = mViolation[1] = 0.0f;
+        mIsAnyClusterAsleep = false;
+        mHasCalmFrames = false;
+        mHasClothBounds = false;
+        mNumColliderPrimitives = 0;
+        mHasSetupColliders = false;
+        mBinCapacity = 0;
+        std::fill(mCollisionTimes, mCollisionTimes + NUM_COLLISION_STAGES, 0.0);
+        mBVHBuildTime = mBVHRefitTime = 0.0;
     }
 
     void ClothSimulationScene::addGUI(nanogui::Screen *screen) {
@@ -88,6 +161,11 @@ namespace pbd {
         mLabelFrameNumber = new Label(win, "Current frame: 0");
         mLabelAverageFrameTime = new Label(win, "");
         mLabelFPS = new Label(win, "");
+        mLabelKernelLaunches = new Label(win, "");
+        mLabelSubStepFusion = new Label(win, "");
+        mLabelSubSteps = new Label(win, "");
+        mLabelCollisionTimes = new Label(win, "");
+        mLabelBVHTimes = new Label(win, "");
         updateTimeLabelsInGUI(0.0);
 
         /// Cloth simulation parameters GUI
@@ -107,9 +185,79 @@ namespace pbd {
         });
 
         gui->addVariable("Projection steps", mParams.numSubSteps);
+        gui->addVariable<bool>("Small steps",
+                               [&](const bool &useSmallSteps) { mParams.useSmallSteps = useSmallSteps; },
+                               [&]() { return mParams.useSmallSteps != 0; });
         gui->addVariable("Delta time (s)", mParams.deltaTime);
         gui->addVariable("Stretch constant", mParams.k_stretch);
         gui->addVariable("Bend constant", mParams.k_bend);
+        gui->addVariable("Solver", mParams.solverMode)->setItems({"Jacobi (atomic)",
+                                                                   "Gauss-Seidel (colored)",
+                                                                   "Jacobi (gather)",
+                                                                   "XPBD (colored)"});
+        gui->addVariable<bool>("Fuse substeps",
+                               [&](const bool &fuse) { mParams.fuseSubSteps = fuse; },
+                               [&]() { return mParams.fuseSubSteps != 0; });
+        gui->addVariable<bool>("Local memory solver",
+                               [&](const bool &useLocal) { mParams.useLocalSolver = useLocal; },
+                               [&]() { return mParams.useLocalSolver != 0; });
+        gui->addVariable("Stretch compliance", mParams.compliance_stretch);
+        gui->addVariable("Bend compliance", mParams.compliance_bend);
+        gui->addVariable("Bend interval", mParams.bendInterval);
+        gui->addVariable("Convergence check interval", mParams.convergenceCheckInterval);
+        gui->addVariable("Convergence tolerance", mParams.convergenceTolerance);
+        gui->addVariable<bool>("Chebyshev acceleration",
+                               [&](const bool &useChebyshev) { mParams.useChebyshev = useChebyshev; },
+                               [&]() { return mParams.useChebyshev != 0; });
+        gui->addVariable("Spectral radius", mParams.spectralRadius);
+        gui->addVariable("Chebyshev warm-up", mParams.chebyshevWarmUp);
+        gui->addVariable("Over-relaxation", mParams.overRelaxation);
+        gui->addVariable<bool>("Multigrid",
+                               [&](const bool &useMultigrid) {
+                                   for (auto &cloth : mClothMeshes) cloth->mUseMultigrid = useMultigrid;
+                               },
+                               [&]() {
+                                   return std::any_of(mClothMeshes.begin(), mClothMeshes.end(),
+                                                      [](const std::shared_ptr<ClothMesh> &cloth) {
+                                                          return cloth->mUseMultigrid;
+                                                      });
+                               });
+        gui->addVariable("Multigrid smoothing steps", mParams.multigridSmoothingSteps);
+        gui->addVariable("Multigrid coarse steps", mParams.multigridCoarseSteps);
+        gui->addVariable<bool>("Sleeping",
+                               [&](const bool &useSleeping) { mParams.useSleeping = useSleeping; },
+                               [&]() { return mParams.useSleeping != 0; });
+        gui->addVariable("Sleep speed", mParams.sleepSpeed);
+        gui->addVariable("Sleep frames", mParams.sleepFrames);
+        gui->addVariable<bool>("Partitioned projection",
+                               [&](const bool &usePartitions) { mParams.usePartitions = usePartitions; },
+                               [&]() { return mParams.usePartitions != 0; });
+        gui->addVariable<bool>("Self-collision",
+                               [&](const bool &useSelfCollision) { mParams.useSelfCollision = useSelfCollision; },
+                               [&]() { return mParams.useSelfCollision != 0; });
+        gui->addVariable("Collision distance", mParams.collisionDistance);
+        gui->addVariable<bool>("Cloth-cloth collision",
+                               [&](const bool &useClothCollision) { mParams.useClothCollision = useClothCollision; },
+                               [&]() { return mParams.useClothCollision != 0; });
+        gui->addVariable<bool>("Collide every substep",
+                               [&](const bool &everySubStep) { mParams.collideEverySubStep = everySubStep; },
+                               [&]() { return mParams.collideEverySubStep != 0; });
+        gui->addVariable<bool>("Triangle BVH",
+                               [&](const bool &useTriangleBVH) { mParams.useTriangleBVH = useTriangleBVH; },
+                               [&]() { return mParams.useTriangleBVH != 0; });
+        gui->addVariable("BVH rebuild ratio", mParams.bvhRebuildRatio);
+        gui->addVariable<bool>("Hash grid",
+                               [&](const bool &useHashGrid) { mParams.useHashGrid = useHashGrid; },
+                               [&]() { return mParams.useHashGrid != 0; });
+        gui->addVariable("Hash buckets per vertex", mParams.hashGridBucketsPerVertex);
+        gui->addVariable<bool>("Adaptive grid",
+                               [&](const bool &useAdaptiveGrid) { mParams.useAdaptiveGrid = useAdaptiveGrid; },
+                               [&]() { return mParams.useAdaptiveGrid != 0; });
+        gui->addVariable<bool>("Deterministic sort",
+                               [&](const bool &useRadixSort) { mParams.useRadixSort = useRadixSort; },
+                               [&]() { return mParams.useRadixSort != 0; });
+        gui->addVariable("Specialize kernels", mSpecializeKernels);
+        gui->addVariable("Fast math (specialized)", mFastMath);
     }
 
     void ClothSimulationScene::reset() {
@@ -117,10 +265,15 @@ namespace pbd {
         updateTimeLabelsInGUI(0.0);
 
         mFrameCounter = 0;
+        mIsGrabbingCloth = false;
         mMemObjects.clear();
         mShaders.clear();
         mRenderObjects.clear();
         mClothMeshes.clear();
+        mTriangleBVH.reset();
+        mParticleSort.reset();
+        mArena.reset();
+        mSdfColliders.reset();
         mLights.clear();
         loadSetup();
     }
@@ -141,6 +294,14 @@ namespace pbd {
         }
 
         ++mFramesSinceLastUpdate;
+        mNumKernelLaunches = 0;
+
+        /// split the frame into small steps if enabled, and switch to the specialized solver kernels
+        /// for the step parameters, once they are compiled
+        mStepParams = mParams.getStepParams();
+        // if fusion is blocked, the projection kernels read unclipped positions and clip_to_planes runs every substep
+        if (!findSubStepFusionBlocker().empty()) mStepParams.fuseSubSteps = 0;
+        updateSolverProgram();
 
         cl::Event event;
         OCL_CALL(mQueue.enqueueAcquireGLObjects(&mMemObjects));
@@ -150,17 +311,17 @@ namespace pbd {
         /// ...
 
         // if is grabbing cloth, move cloth vertex toward cursor ray
-        if (mIsGrabbingCloth) {
+        if (mIsGrabbingCloth && mArena) {
             const glm::vec3 rayOrigin = getCameraWorldPosition();
             const glm::vec3 rayDirection = getCursorWorldRay();
             const float fraction = 0.01f;
 
             cl_float3 velocityCL = {0.0f, 0.0f, 0.0f, 0.0f};
-            Vertex vertex;
-            mQueue.enqueueReadBuffer(mGrabbedClothMesh->mVertexBufferCL, true,
-                                                 sizeof(Vertex) * mGrabbedVertexIndex, sizeof(Vertex), &vertex);
+            glm::vec4 vertexPosition;
+            mQueue.enqueueReadBuffer(mArena->mPositionsBufferCL, true,
+                                     sizeof(cl_float3) * mGrabbedVertexIndex, sizeof(cl_float3), &vertexPosition);
 
-            glm::vec3 position = vertex.position;
+            glm::vec3 position = glm::vec3(vertexPosition);
             position.y = -position.y;
 
             glm::vec3 relposition = position - rayOrigin;
@@ -173,66 +334,100 @@ namespace pbd {
             glm::vec3 newPosition = FRACTION_OLD * position + FRACTION_NEW * projectedPosition;
 
             // apply impulse toward cursor ray
-            vertex.position.x = newPosition.x;
-            vertex.position.y = -newPosition.y;
-            vertex.position.z = newPosition.z;
+            vertexPosition.x = newPosition.x;
+            vertexPosition.y = -newPosition.y;
+            vertexPosition.z = newPosition.z;
 
-            mQueue.enqueueWriteBuffer(mGrabbedClothMesh->mVertexBufferCL, true,
-                                      sizeof(Vertex) * mGrabbedVertexIndex, sizeof(Vertex), &vertex);
-            mQueue.enqueueWriteBuffer(mGrabbedClothMesh->mVertexVelocitiesBufferCL, true,
+            mQueue.enqueueWriteBuffer(mArena->mPositionsBufferCL, true,
+                                      sizeof(cl_float3) * mGrabbedVertexIndex, sizeof(cl_float3), &vertexPosition);
+            mQueue.enqueueWriteBuffer(mArena->mVelocitiesBufferCL, true,
                                       sizeof(cl_float3) * mGrabbedVertexIndex, sizeof(cl_float3), &velocityCL);
         }
 
-        /// apply gravity and predict positions
-        for (auto clothmesh : mClothMeshes) {
-            OCL_CALL(mPredictPositions->setArg(0, clothmesh->mVertexPredictedPositionsBufferCL));
-            OCL_CALL(mPredictPositions->setArg(1, clothmesh->mVertexVelocitiesBufferCL));
-            OCL_CALL(mPredictPositions->setArg(2, clothmesh->mVertexBufferCL));
-            OCL_CALL(mPredictPositions->setArg(3, clothmesh->mVertexClothBufferCL));
-            OCL_CALL(mPredictPositions->setArg(4, mParams.deltaTime));
-            ENQUEUE_VERTICES(mPredictPositions, clothmesh);
-        }
+        if (mArena) {
+            /// put resting sleep clusters to sleep and wake up the ones that are disturbed,
+            /// the kernels below only run over the awake elements
+            updateSleepState();
+            const cl_uint useActiveIDs = mIsAnyClusterAsleep;
+
+            OCL_CALL(mPredictPositions->setArg(0, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mPredictPositions->setArg(1, mArena->mVelocitiesBufferCL));
+            OCL_CALL(mPredictPositions->setArg(2, mArena->mPositionsBufferCL));
+            OCL_CALL(mPredictPositions->setArg(3, mArena->mVertexClothBufferCL));
+            OCL_CALL(mPredictPositions->setArg(4, mStepParams.deltaTime));
+            OCL_CALL(mPredictPositions->setArg(5, mArena->mActiveVerticesBufferCL));
+            OCL_CALL(mPredictPositions->setArg(6, useActiveIDs));
+
+            OCL_CALL(mSetPositionsToPredicted->setArg(0, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mSetPositionsToPredicted->setArg(1, mArena->mPositionsBufferCL));
+            OCL_CALL(mSetPositionsToPredicted->setArg(2, mArena->mVelocitiesBufferCL));
+            OCL_CALL(mSetPositionsToPredicted->setArg(3, mStepParams.deltaTime));
+            OCL_CALL(mSetPositionsToPredicted->setArg(4, mArena->mActiveVerticesBufferCL));
+            OCL_CALL(mSetPositionsToPredicted->setArg(5, useActiveIDs));
+
+            /// decide which cloths collide in this frame, from the bounds of the last frame
+            updateCollisionPairs();
+            if (!mCollisionVertexRanges.empty()) {
+                updateGrid();
+                setCollisionArgs();
+            }
 
-        /// do a number of position-level update iterations
-        for (uint iter = 0; iter < mParams.numSubSteps; ++iter) {
+            /// one step per frame, or numSubSteps small steps of one projection iteration each
+            const uint numSteps = mParams.useSmallSteps ? mParams.numSubSteps : 1;
+            uint subStepsUsed = 0;
+            for (uint step = 0; step < numSteps; ++step) {
+                /// apply gravity and predict positions
+                ENQUEUE_ACTIVE(mPredictPositions, Vertices);
 
-            /// update every clothmesh independently
-            for (auto clothmesh : mClothMeshes) {
+                /// do a number of position-level update iterations, every cloth in the same launches
+                projectConstraints();
+                subStepsUsed += mSubStepsUsed;
 
-                /// clip cloth vertices to be above ground plane
-                mClipToPlanes->setArg(0, clothmesh->mVertexPredictedPositionsBufferCL);
-                ENQUEUE_VERTICES(mClipToPlanes, clothmesh);
+                /// push apart the vertices that came too close, unless that was done after every substep
+                if (!mCollisionVertexRanges.empty() && !mParams.collideEverySubStep) {
+                    enqueueCollisions();
+                }
 
-                /// calculate position correction based on cloth stretch/bend constraints
-                OCL_CALL(mCalcPositionCorrections->setArg(0, clothmesh->mVertexBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(1, clothmesh->mVertexClothBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(2, clothmesh->mEdgeBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(3, clothmesh->mEdgeClothBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(4, clothmesh->mTriangleBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(5, clothmesh->mTriangleClothBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(6, clothmesh->mVertexPredictedPositionsBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(7, clothmesh->mVertexPositionCorrectionsBufferCL));
-                OCL_CALL(mCalcPositionCorrections->setArg(8, sizeof(ClothSimParams), (const void *) &mParams));
-                ENQUEUE_EDGES(mCalcPositionCorrections, clothmesh);
+                /// write predicted/corrected position to actual position
+                ENQUEUE_ACTIVE(mSetPositionsToPredicted, Vertices);
+            }
+            mSubStepsUsed = subStepsUsed;
 
-                /// update predictions based on the corrections
-                OCL_CALL(mCorrectPredictions->setArg(0, clothmesh->mVertexPositionCorrectionsBufferCL));
-                OCL_CALL(mCorrectPredictions->setArg(1, clothmesh->mVertexPredictedPositionsBufferCL));
-                ENQUEUE_VERTICES(mCorrectPredictions, clothmesh);
+            /// a small step is too short for the convergence check, so the stretch that the frame
+            /// ends with is measured instead, to compare the stiffness of both modes in the GUI
+            if (mParams.useSmallSteps && mParams.convergenceCheckInterval > 0) {
+                enqueueViolationCheck();
             }
-        }
 
-        /// write predicted/corrected position to actual position
-        for (auto clothmesh : mClothMeshes) {
-            OCL_CALL(mSetPositionsToPredicted->setArg(0, clothmesh->mVertexPredictedPositionsBufferCL));
-            OCL_CALL(mSetPositionsToPredicted->setArg(1, clothmesh->mVertexBufferCL));
-            OCL_CALL(mSetPositionsToPredicted->setArg(2, clothmesh->mVertexVelocitiesBufferCL));
-            OCL_CALL(mSetPositionsToPredicted->setArg(3, mParams.deltaTime));
-            ENQUEUE_VERTICES(mSetPositionsToPredicted, clothmesh);
+            /// count the calm frames of every sleep cluster for the next frame's sleep state
+            enqueueSleepCheck();
+
+            /// reduce the bounds of every cloth for the next frame's collision pairs
+            enqueueClothBoundsCheck();
+
+            /// fit the triangle BVH to the positions that the frame ends with, or rebuild it once it got too loose
+            if (mParams.useTriangleBVH && mTriangleBVH) {
+                mNumKernelLaunches += mTriangleBVH->enqueueUpdate(mQueue, mArena->mTriangleBufferCL,
+                                                                  mArena->mPositionsBufferCL,
+                                                                  mParams.collisionDistance, mParams.bvhRebuildRatio,
+                                                                  &mBVHBuildEvents, &mBVHRefitEvents);
+            }
+
+            /// copy the simulated positions into the render vertices of each cloth, once per rendered frame
+            OCL_CALL(mCopyPositionsToVertices->setArg(0, mArena->mPositionsBufferCL));
+            for (uint k = 0; k < mClothMeshes.size(); ++k) {
+                // the positions of a sleeping cloth haven't changed since they were last copied
+                if (isClothAsleep(k)) continue;
+
+                OCL_CALL(mCopyPositionsToVertices->setArg(1, mClothMeshes[k]->mVertexBufferCL));
+                OCL_CALL(mCopyPositionsToVertices->setArg(2, mArena->mClothRanges[k].vertexOffset));
+                ENQUEUE_VERTICES(mCopyPositionsToVertices, mClothMeshes[k]);
+            }
         }
 
         OCL_CALL(mQueue.enqueueReleaseGLObjects(&mMemObjects, NULL, &event));
         OCL_CALL(event.wait());
+        readDeviceTimes();
 
         double timeEnd = glfwGetTime();
         while (mSimulationTimes.size() > NUM_AVG_SIM_TIMES) {
@@ -252,6 +447,792 @@ namespace pbd {
         mLabelFrameNumber->setCaption(ss.str());
     }
 
+    void ClothSimulationScene::projectConstraints() {
+        mSubStepsUsed = mStepParams.numSubSteps;
+
+        /// small cloths are solved entirely in local memory, one work-group per cloth
+        if (trySolveInLocalMemory()) return;
+
+        // the arguments are the same for every substep, so they are only set once per frame
+        setProjectionArgs();
+
+        /// the XPBD Lagrange multipliers are accumulated over the substeps of a single time step
+        if (mParams.solverMode == SolverMode::XPBD_COLORED) {
+            OCL_CALL(mQueue.enqueueFillBuffer(mArena->mLambdasBufferCL, 0.0f, 0,
+                                              sizeof(cl_float2) * mArena->numEdges()));
+        }
+
+        const uint checkInterval = mParams.convergenceCheckInterval;
+        bool isCheckPending = false;
+
+        /// Chebyshev weight of the current substep, see correct_predictions
+        const bool useChebyshev = mParams.useChebyshev && mParams.solverMode == SolverMode::JACOBI_ATOMIC;
+        const float rhoSquared = mParams.spectralRadius * mParams.spectralRadius;
+        // the first substep has no previous prediction to extrapolate from
+        const uint warmUp = std::max(mParams.chebyshevWarmUp, 1u);
+        float omega = 1.0f;
+
+        const bool usePartitions = mParams.solverMode == SolverMode::JACOBI_ATOMIC && usePartitionedProjection();
+
+        for (uint iter = 0; iter < mStepParams.numSubSteps; ++iter) {
+            /// check the constraint violation every checkInterval-th substep. The result of a check is read
+            /// at the next check, so that the queue is never drained by a blocking read
+            if (checkInterval > 0 && iter > 0 && iter % checkInterval == 0) {
+                if (isCheckPending) {
+                    OCL_CALL(mViolationReadEvent.wait());
+                    if (mViolation[0] < mParams.convergenceTolerance) {
+                        mSubStepsUsed = iter;
+                        break;
+                    }
+                }
+
+                enqueueViolationCheck();
+                isCheckPending = true;
+            }
+
+            /// clip cloth vertices to be outside of the colliders, unless the projection kernels clip them to
+            /// the ground plane as they read them, see findSubStepFusionBlocker
+            if (!mStepParams.fuseSubSteps) {
+                ENQUEUE_ACTIVE(mClipToPlanes, Vertices);
+            }
+
+            /// push cloth vertices out of the static colliders
+            if (mSdfColliders) {
+                ENQUEUE_ACTIVE(mCollideSdfs, Vertices);
+            }
+
+            /// coarse-level correction of the multigrid cloths, smoothed by the projection below
+            enqueueMultigridVCycles();
+
+            switch (mParams.solverMode) {
+                case SolverMode::GAUSS_SEIDEL_COLORED:
+                    /// project stretch/bend constraints one edge color batch (of all cloths) at a time,
+                    /// the batches are serialized by the in-order queue
+                    for (uint color = 0; color < mArena->numEdgeColors(); ++color) {
+                        const uint offset = mArena->edgeBatchBegin(color, 0);
+                        const uint count = mArena->edgeBatchBegin(color, mArena->numCloths()) - offset;
+                        ENQUEUE_RANGE(mProjectConstraintsColored, offset, count);
+                    }
+                    break;
+
+                case SolverMode::XPBD_COLORED:
+                    /// same batches as GAUSS_SEIDEL_COLORED, with compliant constraints
+                    for (uint color = 0; color < mArena->numEdgeColors(); ++color) {
+                        const uint offset = mArena->edgeBatchBegin(color, 0);
+                        const uint count = mArena->edgeBatchBegin(color, mArena->numCloths()) - offset;
+                        ENQUEUE_RANGE(mProjectConstraintsXPBD, offset, count);
+                    }
+                    break;
+
+                case SolverMode::JACOBI_GATHER:
+                    /// project stretch/bend constraints into per-constraint slots and gather them per vertex
+                    ENQUEUE_EDGES(mCalcConstraintDeltas, mArena);
+                    ENQUEUE_VERTICES(mGatherPositionCorrections, mArena);
+                    break;
+
+                case SolverMode::JACOBI_ATOMIC:
+                default:
+                {
+                    /// calculate position correction based on cloth stretch constraints, and on the
+                    /// bend constraints every bendInterval-th substep
+                    const bool projectBend = mArena->numBendConstraints() > 0
+                                             && iter % std::max(mParams.bendInterval, 1u) == 0;
+                    if (usePartitions) {
+                        /// one work-group per partition, which only does global atomics for shared vertices
+                        OCL_CALL(mCalcPartitionPositionCorrections->setArg(12, static_cast<cl_uint>(projectBend)));
+                        const ::size_t globalSize = mArena->numPartitions() * mPartitionWorkGroupSize;
+                        ++mNumKernelLaunches;
+                        OCL_CALL(mQueue.enqueueNDRangeKernel(*mCalcPartitionPositionCorrections, cl::NullRange,
+                                                             cl::NDRange(globalSize),
+                                                             cl::NDRange(mPartitionWorkGroupSize)));
+                    } else {
+                        ENQUEUE_ACTIVE(mCalcStretchPositionCorrections, StretchConstraints);
+                        if (projectBend) {
+                            ENQUEUE_ACTIVE(mCalcBendPositionCorrections, BendConstraints);
+                        }
+                    }
+
+                    /// update predictions based on the corrections, extrapolated by the Chebyshev weights
+                    /// omega(warmUp) = 2 / (2 - rho^2), omega(k + 1) = 4 / (4 - rho^2 omega(k))
+                    if (useChebyshev && iter >= warmUp) {
+                        omega = iter == warmUp ? 2.0f / (2.0f - rhoSquared)
+                                               : 4.0f / (4.0f - rhoSquared * omega);
+                        OCL_CALL(mCorrectPredictions->setArg(3, omega));
+                    }
+                    // a separate launch even with fused substeps: a vertex's correction is only complete once
+                    // every constraint of the substep was projected, and there is no barrier across work-groups
+                    ENQUEUE_ACTIVE(mCorrectPredictions, Vertices);
+                    break;
+                }
+            }
+
+            if (!mCollisionVertexRanges.empty() && mParams.collideEverySubStep) {
+                enqueueCollisions();
+            }
+        }
+    }
+
+    void ClothSimulationScene::enqueueMultigridVCycles() {
+        // the levels of different cloths need different numbers of steps, so every cloth gets its own
+        // launches. Multigrid is meant for a few high-resolution cloths, so this adds few launches
+        for (uint k = 0; k < mClothMeshes.size(); ++k) {
+            const uint numLevels = mArena->numMultigridLevels(k);
+            if (!mClothMeshes[k]->mUseMultigrid || numLevels == 0) continue;
+
+            /// restrict the predictions to every coarser level and smooth it on the way down,
+            /// the coarsest level gets more steps since its constraints span the whole cloth
+            for (uint level = 1; level <= numLevels; ++level) {
+                const uint begin = mArena->levelVertexBegin(level, k);
+                ENQUEUE_RANGE(mRestrictPositions, begin, mArena->levelVertexBegin(level, k + 1) - begin);
+
+                smoothMultigridLevel(level, k, level == numLevels ? mParams.multigridCoarseSteps
+                                                                  : mParams.multigridSmoothingSteps);
+            }
+
+            /// prolong the displacement of every level to the next finer level and smooth that on the
+            /// way up, the finest level is smoothed by the regular projection of the substep
+            for (uint level = numLevels; level >= 1; --level) {
+                const uint begin = mArena->levelStencilBegin(level, k);
+                ENQUEUE_RANGE(mProlongCorrections, begin, mArena->levelStencilBegin(level, k + 1) - begin);
+
+                if (level > 1) {
+                    smoothMultigridLevel(level - 1, k, mParams.multigridSmoothingSteps);
+                }
+            }
+        }
+    }
+
+    void ClothSimulationScene::smoothMultigridLevel(uint level, uint cloth, uint steps) {
+        const uint constraintBegin = mArena->levelConstraintBegin(level, cloth);
+        const uint numConstraints = mArena->levelConstraintBegin(level, cloth + 1) - constraintBegin;
+        const uint vertexBegin = mArena->levelVertexBegin(level, cloth);
+        const uint numVertices = mArena->levelVertexBegin(level, cloth + 1) - vertexBegin;
+        if (numConstraints == 0) return;
+
+        for (uint step = 0; step < steps; ++step) {
+            ENQUEUE_RANGE(mProjectLevelConstraints, constraintBegin, numConstraints);
+            ENQUEUE_RANGE(mCorrectLevelPredictions, vertexBegin, numVertices);
+        }
+    }
+
+    void ClothSimulationScene::updateSleepState() {
+        const uint numClusters = static_cast<uint>(mArena->numSleepClusters());
+
+        // any parameter change may set resting cloth in motion again
+        const bool hasParamsChanged = std::memcmp(&mParams, &mSleepParams, sizeof(ClothSimParams)) != 0;
+        mSleepParams = mParams;
+
+        std::vector<bool> isAsleep(numClusters, false);
+        if (mParams.useSleeping && mParams.solverMode == SolverMode::JACOBI_ATOMIC
+            && !hasParamsChanged && mHasCalmFrames) {
+            OCL_CALL(mCalmFramesReadEvent.wait());
+
+            for (uint c = 0; c < numClusters; ++c) {
+                if (mCalmFrames[c] < mParams.sleepFrames) continue;
+
+                // the coarse multigrid levels move their vertices regardless of the sleep state
+                const uint cloth = static_cast<uint>(std::upper_bound(mArena->mClothSleepClusterOffsets.begin(),
+                                                                      mArena->mClothSleepClusterOffsets.end(), c)
+                                                     - mArena->mClothSleepClusterOffsets.begin()) - 1;
+                if (mClothMeshes[cloth]->mUseMultigrid && mArena->numMultigridLevels(cloth) > 0) continue;
+
+                // a cluster is woken up by any neighbour that moved in the last frame. A cluster that an awake
+                // vertex collided with counts as moving, see kernels/counting_sort.cl -> collide_particles
+                bool isNeighbourMoving = false;
+                for (uint i = mArena->mSleepClusterNeighbourOffsets[c];
+                     i < mArena->mSleepClusterNeighbourOffsets[c + 1]; ++i) {
+                    isNeighbourMoving |= mCalmFrames[mArena->mSleepClusterNeighbours[i]] == 0;
+                }
+                isAsleep[c] = !isNeighbourMoving;
+            }
+        }
+
+        // the grabbed vertex is moved by the cursor
+        if (mIsGrabbingCloth) {
+            isAsleep[mArena->findSleepCluster(mGrabbedVertexIndex)] = false;
+        }
+
+        if (isAsleep == mIsClusterAsleep) return;
+
+        for (uint c = 0; c < numClusters; ++c) {
+            if (isAsleep[c] == mIsClusterAsleep[c]) continue;
+
+            const uint vertexBegin = mArena->mSleepClusterOffsets[c];
+            const uint vertexCount = mArena->mSleepClusterOffsets[c + 1] - vertexBegin;
+
+            if (isAsleep[c]) {
+                /// a cluster falls asleep at rest
+                OCL_CALL(mQueue.enqueueFillBuffer(mArena->mVelocitiesBufferCL, glm::vec4(0.0f),
+                                                  sizeof(glm::vec4) * vertexBegin, sizeof(glm::vec4) * vertexCount));
+            } else {
+                /// discard the corrections that the constraints of awake neighbours added while the
+                /// cluster was asleep, and keep it awake for at least sleepFrames frames. The count
+                /// restarts at 1, since 0 means that it moved and would wake up its neighbours
+                OCL_CALL(mQueue.enqueueFillBuffer(mArena->mPositionCorrectionsBufferCL, glm::vec4(0.0f),
+                                                  sizeof(glm::vec4) * vertexBegin, sizeof(glm::vec4) * vertexCount));
+                OCL_CALL(mQueue.enqueueFillBuffer(mArena->mSleepClusterCalmFramesBufferCL, static_cast<cl_uint>(1),
+                                                  sizeof(cl_uint) * c, sizeof(cl_uint)));
+            }
+        }
+
+        mIsClusterAsleep = std::move(isAsleep);
+        mIsAnyClusterAsleep = std::find(mIsClusterAsleep.begin(), mIsClusterAsleep.end(), true)
+                              != mIsClusterAsleep.end();
+        mArena->updateActiveLists(mQueue, mIsClusterAsleep);
+    }
+
+    void ClothSimulationScene::enqueueSleepCheck() {
+        if (!mParams.useSleeping || mParams.solverMode != SolverMode::JACOBI_ATOMIC) {
+            mHasCalmFrames = false;
+            return;
+        }
+
+        OCL_CALL(mCalcClusterSpeeds->setArg(0, mArena->mVelocitiesBufferCL));
+        OCL_CALL(mCalcClusterSpeeds->setArg(1, mArena->mVertexSleepClusterBufferCL));
+        OCL_CALL(mCalcClusterSpeeds->setArg(2, mArena->mSleepClusterSpeedsBufferCL));
+        OCL_CALL(mCalcClusterSpeeds->setArg(3, mArena->mActiveVerticesBufferCL));
+        OCL_CALL(mCalcClusterSpeeds->setArg(4, static_cast<cl_uint>(mIsAnyClusterAsleep)));
+        ENQUEUE_ACTIVE(mCalcClusterSpeeds, Vertices);
+
+        OCL_CALL(mCountCalmFrames->setArg(0, mArena->mSleepClusterSpeedsBufferCL));
+        OCL_CALL(mCountCalmFrames->setArg(1, mArena->mSleepClusterCalmFramesBufferCL));
+        OCL_CALL(mCountCalmFrames->setArg(2, mParams.sleepSpeed));
+        ENQUEUE_RANGE(mCountCalmFrames, 0, mArena->numSleepClusters());
+
+        // non-blocking, mCalmFrames is only read after waiting for mCalmFramesReadEvent
+        OCL_CALL(mQueue.enqueueReadBuffer(mArena->mSleepClusterCalmFramesBufferCL, false, 0,
+                                          sizeof(cl_uint) * mCalmFrames.size(), mCalmFrames.data(),
+                                          NULL, &mCalmFramesReadEvent));
+        mHasCalmFrames = true;
+    }
+
+    bool ClothSimulationScene::isClothAsleep(uint cloth) const {
+        const auto begin = mIsClusterAsleep.begin() + mArena->mClothSleepClusterOffsets[cloth];
+        const auto end = mIsClusterAsleep.begin() + mArena->mClothSleepClusterOffsets[cloth + 1];
+        return std::find(begin, end, false) == end;
+    }
+
+    void ClothSimulationScene::enqueueViolationCheck() {
+        const cl_uint numConstraints = static_cast<cl_uint>(mArena->numStretchConstraints());
+        const ::size_t localSize = mViolationWorkGroupSize;
+        const ::size_t globalSize = localSize * ((numConstraints + localSize - 1) / localSize);
+
+        OCL_CALL(mQueue.enqueueFillBuffer(mArena->mViolationBufferCL, 0.0f, 0, sizeof(cl_float) * 2));
+
+        OCL_CALL(mCalcConstraintViolation->setArg(0, mArena->mStretchConstraintsBufferCL));
+        OCL_CALL(mCalcConstraintViolation->setArg(1, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mCalcConstraintViolation->setArg(2, numConstraints));
+        OCL_CALL(mCalcConstraintViolation->setArg(3, cl::Local(sizeof(cl_float) * localSize)));
+        OCL_CALL(mCalcConstraintViolation->setArg(4, cl::Local(sizeof(cl_float) * localSize)));
+        OCL_CALL(mCalcConstraintViolation->setArg(5, mArena->mViolationBufferCL));
+        OCL_CALL(mCalcConstraintViolation->setArg(6, sizeof(ClothSimParams), (const void *) &mStepParams));
+
+        ++mNumKernelLaunches;
+        OCL_CALL(mQueue.enqueueNDRangeKernel(*mCalcConstraintViolation, cl::NullRange,
+                                             cl::NDRange(globalSize), cl::NDRange(localSize)));
+
+        // non-blocking, mViolation is only read after waiting for mViolationReadEvent
+        OCL_CALL(mQueue.enqueueReadBuffer(mArena->mViolationBufferCL, false, 0, sizeof(cl_float) * 2,
+                                          mViolation, NULL, &mViolationReadEvent));
+    }
+
+    void ClothSimulationScene::updateGrid() {
+        // a bounded grid has at most this many bins per vertex, its bins grow to cover larger scenes
+        const float maxBinsPerVertex = 4.0f;
+
+        /// the bins are about one rest edge long, so that a bin holds a few vertices of a flat cloth
+        Grid grid;
+        grid.binSize = mParams.useAdaptiveGrid ? std::max(mArena->meanRestEdgeLength(), mParams.collisionDistance)
+                                               : 0.1f;
+        grid.isHashed = mParams.useHashGrid != 0;
+
+        if (grid.isHashed) {
+            // the table grows with the number of vertices instead of the extent of the scene
+            const float numBuckets = std::max(mParams.hashGridBucketsPerVertex, 0.0f) * mArena->numVertices();
+            grid.binCount = 1;
+            while (grid.binCount < numBuckets && grid.binCount < (1u << 31)) {
+                grid.binCount *= 2;
+            }
+            std::fill(grid.origin, grid.origin + 3, 0.0f);
+            std::fill(grid.binCount3D, grid.binCount3D + 3, 0u);
+        } else if (mParams.useAdaptiveGrid && mHasClothBounds) {
+            /// the bounds of the scene are a frame old, so they are grown by twice the distance that the
+            /// fastest vertex moved in a frame. Vertices that still end up outside are clamped into the border bins
+            const cl_uint *bounds = &mClothBounds[8 * mArena->numCloths()];
+            float maxSpeed;
+            std::memcpy(&maxSpeed, &bounds[3], sizeof(float));
+            const glm::vec3 margin(2.0f * maxSpeed * mParams.deltaTime + grid.binSize);
+            const glm::vec3 lower = glm::vec3(FromOrderedUint(bounds[0]), FromOrderedUint(bounds[1]),
+                                              FromOrderedUint(bounds[2])) - margin;
+            const glm::vec3 extent = glm::vec3(FromOrderedUint(bounds[4]), FromOrderedUint(bounds[5]),
+                                               FromOrderedUint(bounds[6])) + margin - lower;
+
+            const float maxBins = std::max(maxBinsPerVertex * mArena->numVertices(), 1.0f);
+            const float volume = extent.x * extent.y * extent.z;
+            if (volume > maxBins * grid.binSize * grid.binSize * grid.binSize) {
+                grid.binSize = std::cbrt(volume / maxBins);
+            }
+
+            for (int axis = 0; axis < 3; ++axis) {
+                grid.origin[axis] = lower[axis];
+                grid.binCount3D[axis] = std::max(static_cast<cl_uint>(std::ceil(extent[axis] / grid.binSize)), 1u);
+            }
+            grid.binCount = grid.binCount3D[0] * grid.binCount3D[1] * grid.binCount3D[2];
+        } else {
+            // the fixed grid covers [-1, 0.6] x [-1, 1] x [-1, 1] with its 0.1 bins, also before the first bounds
+            grid.binSize = 0.1f;
+            std::fill(grid.origin, grid.origin + 3, -1.0f);
+            grid.binCount3D[0] = 16;
+            grid.binCount3D[1] = grid.binCount3D[2] = 20;
+            grid.binCount = 16 * 20 * 20;
+        }
+        mGridCL = util::make_unique<Grid>(grid);
+
+        /// the bin buffers only grow, the grid is a kernel argument and may shrink without reallocating them
+        if (mGridCL->binCount <= mBinCapacity) return;
+        mBinCapacity = mGridCL->binCount;
+
+        OCL_ERROR;
+        OCL_CHECK(mBinCountCL = util::make_unique<cl::Buffer>(mContext,
+                                                              CL_MEM_READ_WRITE,
+                                                              sizeof(cl_uint) * mBinCapacity,
+                                                              (void*)0, CL_ERROR));
+        OCL_CHECK(mBinStartIDCL = util::make_unique<cl::Buffer>(mContext,
+                                                                CL_MEM_READ_WRITE,
+                                                                sizeof(cl_uint) * mBinCapacity,
+                                                                (void*)0, CL_ERROR));
+        mBinStartIDScan = util::make_unique<util::PrefixScan>(mContext, mDevice, mBinCapacity);
+    }
+
+    void ClothSimulationScene::setCollisionArgs() {
+        const cl_uint useActiveIDs = mIsAnyClusterAsleep;
+        // collisions only wake clusters while sleeping is active, see updateSleepState
+        const cl_uint wakeClusters = mParams.useSleeping && mParams.solverMode == SolverMode::JACOBI_ATOMIC;
+
+        // the 27 bins around a vertex only contain every vertex within the collision distance if it
+        // is at most the bin size
+        const cl_float collisionDistance = std::min(mParams.collisionDistance, mGridCL->binSize);
+
+        OCL_CALL(mInsertParticles->setArg(0, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mInsertParticles->setArg(1, mArena->mVertexBinBufferCL));
+        OCL_CALL(mInsertParticles->setArg(2, mArena->mVertexInBinPosCL));
+        OCL_CALL(mInsertParticles->setArg(3, *mBinCountCL));
+        OCL_CALL(mInsertParticles->setArg(4, sizeof(Grid), (const void *) mGridCL.get()));
+        OCL_CALL(mInsertParticles->setArg(5, mArena->mSortedBinsBufferCL));
+        OCL_CALL(mInsertParticles->setArg(6, mArena->mSortedVerticesBufferCL));
+
+        OCL_CALL(mSortParticles->setArg(0, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mSortParticles->setArg(1, mArena->mVertexBinBufferCL));
+        OCL_CALL(mSortParticles->setArg(2, mArena->mVertexInBinPosCL));
+        OCL_CALL(mSortParticles->setArg(3, *mBinStartIDCL));
+        OCL_CALL(mSortParticles->setArg(4, mArena->mSortedVerticesBufferCL));
+        OCL_CALL(mSortParticles->setArg(5, mArena->mSortedPositionsBufferCL));
+
+        OCL_CALL(mCollideParticles->setArg(0, mArena->mVertexClothBufferCL));
+        OCL_CALL(mCollideParticles->setArg(1, mArena->mRestPositionsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(2, *mBinCountCL));
+        OCL_CALL(mCollideParticles->setArg(3, *mBinStartIDCL));
+        OCL_CALL(mCollideParticles->setArg(4, mArena->mSortedVerticesBufferCL));
+        OCL_CALL(mCollideParticles->setArg(5, mArena->mSortedPositionsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(6, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(7, mArena->mActiveVerticesBufferCL));
+        OCL_CALL(mCollideParticles->setArg(8, useActiveIDs));
+        OCL_CALL(mCollideParticles->setArg(9, collisionDistance));
+        OCL_CALL(mCollideParticles->setArg(10, mArena->mVertexClothIDsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(11, mArena->mClothPairsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(12, static_cast<cl_uint>(mArena->numCloths())));
+        OCL_CALL(mCollideParticles->setArg(13, sizeof(Grid), (const void *) mGridCL.get()));
+        OCL_CALL(mCollideParticles->setArg(14, mArena->mVertexSleepClusterBufferCL));
+        OCL_CALL(mCollideParticles->setArg(15, mArena->mSleepClusterSpeedsBufferCL));
+        OCL_CALL(mCollideParticles->setArg(16, wakeClusters));
+    }
+
+    void ClothSimulationScene::updateCollisionPairs() {
+        const uint numCloths = static_cast<uint>(mArena->numCloths());
+        std::vector<cl_uint> pairs(numCloths * numCloths, 0);
+
+        if (mParams.useSelfCollision) {
+            for (uint k = 0; k < numCloths; ++k) {
+                pairs[k * numCloths + k] = 1;
+            }
+        }
+
+        /// the bounds of the last frame cull the cloth pairs here and fit the grid in #updateGrid
+        if (mHasClothBounds) {
+            OCL_CALL(mClothBoundsReadEvent.wait());
+        }
+
+        if (mParams.useClothCollision && numCloths > 1) {
+            /// the bounds are a frame old, so every box is grown by twice the distance that the fastest vertex
+            /// of its cloth moved in a frame. Without bounds (in the first frame) every pair collides
+            std::vector<glm::vec3> lower(numCloths, glm::vec3(-std::numeric_limits<float>::max()));
+            std::vector<glm::vec3> upper(numCloths, glm::vec3(std::numeric_limits<float>::max()));
+            if (mHasClothBounds) {
+                for (uint k = 0; k < numCloths; ++k) {
+                    const cl_uint *bounds = &mClothBounds[8 * k];
+                    float maxSpeed;
+                    std::memcpy(&maxSpeed, &bounds[3], sizeof(float));
+                    const glm::vec3 margin(2.0f * maxSpeed * mParams.deltaTime + 0.5f * mParams.collisionDistance);
+                    lower[k] = glm::vec3(FromOrderedUint(bounds[0]), FromOrderedUint(bounds[1]),
+                                         FromOrderedUint(bounds[2])) - margin;
+                    upper[k] = glm::vec3(FromOrderedUint(bounds[4]), FromOrderedUint(bounds[5]),
+                                         FromOrderedUint(bounds[6])) + margin;
+                }
+            }
+
+            for (uint k = 0; k < numCloths; ++k) {
+                for (uint l = k + 1; l < numCloths; ++l) {
+                    const bool isOverlapping = glm::all(glm::lessThanEqual(lower[k], upper[l]))
+                                               && glm::all(glm::lessThanEqual(lower[l], upper[k]));
+                    pairs[k * numCloths + l] = pairs[l * numCloths + k] = isOverlapping;
+                }
+            }
+        }
+
+        /// only the cloths that collide with anything are binned, neighbouring cloths in one range
+        mCollisionVertexRanges.clear();
+        for (uint k = 0; k < numCloths; ++k) {
+            const auto row = pairs.begin() + k * numCloths;
+            if (std::find(row, row + numCloths, 1u) == row + numCloths) continue;
+
+            const ClothRange &range = mArena->mClothRanges[k];
+            if (!mCollisionVertexRanges.empty()
+                && mCollisionVertexRanges.back().first + mCollisionVertexRanges.back().second == range.vertexOffset) {
+                mCollisionVertexRanges.back().second += range.numVertices;
+            } else {
+                mCollisionVertexRanges.push_back(std::make_pair(range.vertexOffset, range.numVertices));
+            }
+        }
+
+        // non-blocking, mClothPairs isn't changed before the frame has finished
+        if (pairs != mClothPairs) {
+            mClothPairs = std::move(pairs);
+            OCL_CALL(mQueue.enqueueWriteBuffer(mArena->mClothPairsBufferCL, false, 0,
+                                               sizeof(cl_uint) * mClothPairs.size(), mClothPairs.data()));
+        }
+    }
+
+    void ClothSimulationScene::enqueueClothBoundsCheck() {
+        const bool isCullingCloths = mParams.useClothCollision && mArena->numCloths() > 1;
+        const bool isFittingGrid = mParams.useAdaptiveGrid && !mParams.useHashGrid
+                                   && (mParams.useSelfCollision || mParams.useClothCollision);
+        if (!isCullingCloths && !isFittingGrid) {
+            mHasClothBounds = false;
+            return;
+        }
+
+        // [min xyz, max speed, max xyz, unused] per cloth and for the scene, see calc_cloth_bounds
+        cl_uint8 emptyBounds;
+        for (uint i = 0; i < 8; ++i) {
+            emptyBounds.s[i] = i < 3 ? 0xFFFFFFFFu : 0u;
+        }
+        OCL_CALL(mQueue.enqueueFillBuffer(mArena->mClothBoundsBufferCL, emptyBounds, 0,
+                                          sizeof(cl_uint8) * (mArena->numCloths() + 1)));
+
+        const cl_uint numVertices = static_cast<cl_uint>(mArena->numVertices());
+        const ::size_t localSize = mBoundsWorkGroupSize;
+        const ::size_t globalSize = localSize * ((numVertices + localSize - 1) / localSize);
+
+        OCL_CALL(mCalcClothBounds->setArg(0, mArena->mPositionsBufferCL));
+        OCL_CALL(mCalcClothBounds->setArg(1, mArena->mVelocitiesBufferCL));
+        OCL_CALL(mCalcClothBounds->setArg(2, mArena->mVertexClothIDsBufferCL));
+        OCL_CALL(mCalcClothBounds->setArg(3, mArena->mClothBoundsBufferCL));
+        OCL_CALL(mCalcClothBounds->setArg(4, numVertices));
+        OCL_CALL(mCalcClothBounds->setArg(5, static_cast<cl_uint>(mArena->numCloths())));
+        OCL_CALL(mCalcClothBounds->setArg(6, cl::Local(sizeof(cl_uint4) * localSize)));
+        OCL_CALL(mCalcClothBounds->setArg(7, cl::Local(sizeof(cl_uint4) * localSize)));
+
+        ++mNumKernelLaunches;
+        OCL_CALL(mQueue.enqueueNDRangeKernel(*mCalcClothBounds, cl::NullRange,
+                                             cl::NDRange(globalSize), cl::NDRange(localSize)));
+
+        // non-blocking, mClothBounds is only read after waiting for mClothBoundsReadEvent
+        OCL_CALL(mQueue.enqueueReadBuffer(mArena->mClothBoundsBufferCL, false, 0,
+                                          sizeof(cl_uint) * mClothBounds.size(), mClothBounds.data(),
+                                          NULL, &mClothBoundsReadEvent));
+        mHasClothBounds = true;
+    }
+
+    void ClothSimulationScene::enqueueCollisions() {
+        // every stage is a single launch per vertex range (or over all bins), so the cost is linear in their number
+        auto enqueueStage = [&](cl::Kernel &kernel, const ::size_t offset, const ::size_t count,
+                                const CollisionStage stage) {
+            cl::Event event;
+            ++mNumKernelLaunches;
+            OCL_CALL(mQueue.enqueueNDRangeKernel(kernel, cl::NDRange(offset), cl::NDRange(count), cl::NullRange,
+                                                 NULL, &event));
+            mCollisionEvents[stage].push_back(event);
+        };
+
+        /// count the colliding vertices per bin, asleep or not
+        cl::Event event;
+        OCL_CALL(mQueue.enqueueFillBuffer(*mBinCountCL, static_cast<cl_uint>(0), 0,
+                                          sizeof(cl_uint) * mGridCL->binCount, NULL, &event));
+        mCollisionEvents[COLLISION_BIN].push_back(event);
+        cl_uint numSorted = 0;
+        for (const auto &range : mCollisionVertexRanges) {
+            OCL_CALL(mInsertParticles->setArg(7, numSorted));
+            enqueueStage(*mInsertParticles, range.first, range.second, COLLISION_BIN);
+            numSorted += range.second;
+        }
+
+        /// the first sorted index of every bin
+        mNumKernelLaunches += mBinStartIDScan->enqueue(mQueue, *mBinCountCL, *mBinStartIDCL, mGridCL->binCount,
+                                                       &mCollisionEvents[COLLISION_SCAN]);
+
+        if (mParams.useRadixSort) {
+            /// a stable sort of the packed (bin, vertex ID) pairs in increasing ID order by their bins only
+            /// sorts by bin first and ID second, the same permutation on every run
+            uint numBits = 1;
+            while (numBits < 32 && (1u << numBits) < mGridCL->binCount) ++numBits;
+            mNumKernelLaunches += mParticleSort->enqueue(mQueue, mArena->mSortedBinsBufferCL,
+                                                         mArena->mSortedVerticesBufferCL, numSorted, numBits,
+                                                         &mCollisionEvents[COLLISION_SORT]);
+            mNumKernelLaunches += mParticleSort->enqueueGather(mQueue, mArena->mPredictedPositionsBufferCL,
+                                                               mArena->mSortedVerticesBufferCL,
+                                                               mArena->mSortedPositionsBufferCL, numSorted,
+                                                               sizeof(glm::vec4), &mCollisionEvents[COLLISION_SORT]);
+        } else {
+            for (const auto &range : mCollisionVertexRanges) {
+                enqueueStage(*mSortParticles, range.first, range.second, COLLISION_SORT);
+            }
+        }
+
+        /// only the awake vertices are moved, the vertices of cloths that collide with nothing find no contacts
+        if (mIsAnyClusterAsleep) {
+            if (mArena->numActiveVertices() > 0) {
+                enqueueStage(*mCollideParticles, 0, mArena->numActiveVertices(), COLLISION_RESOLVE);
+            }
+        } else {
+            for (const auto &range : mCollisionVertexRanges) {
+                enqueueStage(*mCollideParticles, range.first, range.second, COLLISION_RESOLVE);
+            }
+        }
+    }
+
+    void ClothSimulationScene::readDeviceTimes() {
+        for (uint stage = 0; stage < NUM_COLLISION_STAGES; ++stage) {
+            mCollisionTimes[stage] = SumEventTimes(mCollisionEvents[stage]);
+        }
+        mBVHBuildTime = SumEventTimes(mBVHBuildEvents);
+        mBVHRefitTime = SumEventTimes(mBVHRefitEvents);
+    }
+
+    std::string ClothSimulationScene::findSubStepFusionBlocker() const {
+        // read_predicted only clips to the ground plane, clipping to every primitive on every read of a
+        // vertex would cost more than the launch that fusion saves
+        if (mHasSetupColliders) return "the setup has colliders";
+
+        // the colored solvers only read the vertices of their edges, the others would never be clipped
+        const bool isColored = mParams.solverMode == SolverMode::GAUSS_SEIDEL_COLORED
+                               || mParams.solverMode == SolverMode::XPBD_COLORED;
+        if (isColored && mArena && mArena->hasUnconstrainedVertices()) return "vertices without edges";
+
+        return "";
+    }
+
+    void ClothSimulationScene::setProjectionArgs() {
+        const auto paramsSize = sizeof(ClothSimParams);
+        const auto params = (const void *) &mStepParams;
+
+        const cl_uint useActiveIDs = mIsAnyClusterAsleep;
+
+        OCL_CALL(mClipToPlanes->setArg(0, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mClipToPlanes->setArg(1, mArena->mActiveVerticesBufferCL));
+        OCL_CALL(mClipToPlanes->setArg(2, useActiveIDs));
+        OCL_CALL(mClipToPlanes->setArg(3, *mColliderPrimitivesCL));
+        OCL_CALL(mClipToPlanes->setArg(4, mNumColliderPrimitives));
+
+        if (mSdfColliders) {
+            OCL_CALL(mCollideSdfs->setArg(0, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mCollideSdfs->setArg(1, mSdfColliders->mCollidersBufferCL));
+            OCL_CALL(mCollideSdfs->setArg(2, mSdfColliders->mBrickTableBufferCL));
+            OCL_CALL(mCollideSdfs->setArg(3, mSdfColliders->mBrickSamplesBufferCL));
+            OCL_CALL(mCollideSdfs->setArg(4, mSdfColliders->numColliders()));
+            OCL_CALL(mCollideSdfs->setArg(5, mParams.collisionDistance));
+            OCL_CALL(mCollideSdfs->setArg(6, mArena->mActiveVerticesBufferCL));
+            OCL_CALL(mCollideSdfs->setArg(7, useActiveIDs));
+        }
+
+        if (mArena->numMultigridLevels() > 0) {
+            OCL_CALL(mRestrictPositions->setArg(0, mArena->mLevelVerticesBufferCL));
+            OCL_CALL(mRestrictPositions->setArg(1, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mRestrictPositions->setArg(2, mArena->mLevelPositionsBufferCL));
+            OCL_CALL(mRestrictPositions->setArg(3, paramsSize, params));
+
+            OCL_CALL(mProjectLevelConstraints->setArg(0, mArena->mVertexClothBufferCL));
+            OCL_CALL(mProjectLevelConstraints->setArg(1, mArena->mLevelConstraintsBufferCL));
+            OCL_CALL(mProjectLevelConstraints->setArg(2, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mProjectLevelConstraints->setArg(3, mArena->mPositionCorrectionsBufferCL));
+            OCL_CALL(mProjectLevelConstraints->setArg(4, mArena->mActiveStretchConstraintsBufferCL));
+            OCL_CALL(mProjectLevelConstraints->setArg(5, static_cast<cl_uint>(0)));
+            OCL_CALL(mProjectLevelConstraints->setArg(6, paramsSize, params));
+
+            OCL_CALL(mCorrectLevelPredictions->setArg(0, mArena->mLevelVerticesBufferCL));
+            OCL_CALL(mCorrectLevelPredictions->setArg(1, mArena->mPositionCorrectionsBufferCL));
+            OCL_CALL(mCorrectLevelPredictions->setArg(2, mArena->mPredictedPositionsBufferCL));
+            OCL_CALL(mCorrectLevelPredictions->setArg(3, paramsSize, params));
+
+            OCL_CALL(mProlongCorrections->setArg(0, mArena->mVertexClothBufferCL));
+            OCL_CALL(mProlongCorrections->setArg(1, mArena->mLevelStencilsBufferCL));
+            OCL_CALL(mProlongCorrections->setArg(2, mArena->mLevelVerticesBufferCL));
+            OCL_CALL(mProlongCorrections->setArg(3, mArena->mLevelPositionsBufferCL));
+            OCL_CALL(mProlongCorrections->setArg(4, mArena->mPredictedPositionsBufferCL));
+        }
+
+        switch (mParams.solverMode) {
+            case SolverMode::GAUSS_SEIDEL_COLORED:
+                OCL_CALL(mProjectConstraintsColored->setArg(0, mArena->mVertexClothBufferCL));
+                OCL_CALL(mProjectConstraintsColored->setArg(1, mArena->mEdgeBufferCL));
+                OCL_CALL(mProjectConstraintsColored->setArg(2, mArena->mEdgeClothBufferCL));
+                OCL_CALL(mProjectConstraintsColored->setArg(3, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mProjectConstraintsColored->setArg(4, paramsSize, params));
+                break;
+
+            case SolverMode::XPBD_COLORED:
+                OCL_CALL(mProjectConstraintsXPBD->setArg(0, mArena->mVertexClothBufferCL));
+                OCL_CALL(mProjectConstraintsXPBD->setArg(1, mArena->mEdgeBufferCL));
+                OCL_CALL(mProjectConstraintsXPBD->setArg(2, mArena->mEdgeClothBufferCL));
+                OCL_CALL(mProjectConstraintsXPBD->setArg(3, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mProjectConstraintsXPBD->setArg(4, mArena->mLambdasBufferCL));
+                OCL_CALL(mProjectConstraintsXPBD->setArg(5, paramsSize, params));
+                break;
+
+            case SolverMode::JACOBI_GATHER:
+                OCL_CALL(mCalcConstraintDeltas->setArg(0, mArena->mVertexClothBufferCL));
+                OCL_CALL(mCalcConstraintDeltas->setArg(1, mArena->mEdgeBufferCL));
+                OCL_CALL(mCalcConstraintDeltas->setArg(2, mArena->mEdgeClothBufferCL));
+                OCL_CALL(mCalcConstraintDeltas->setArg(3, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mCalcConstraintDeltas->setArg(4, mArena->mConstraintDeltasBufferCL));
+                OCL_CALL(mCalcConstraintDeltas->setArg(5, paramsSize, params));
+
+                OCL_CALL(mGatherPositionCorrections->setArg(0, mArena->mVertexSlotOffsetsBufferCL));
+                OCL_CALL(mGatherPositionCorrections->setArg(1, mArena->mVertexSlotsBufferCL));
+                OCL_CALL(mGatherPositionCorrections->setArg(2, mArena->mConstraintDeltasBufferCL));
+                OCL_CALL(mGatherPositionCorrections->setArg(3, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mGatherPositionCorrections->setArg(4, paramsSize, params));
+                break;
+
+            case SolverMode::JACOBI_ATOMIC:
+            default:
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(0, mArena->mVertexClothBufferCL));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(1, mArena->mStretchConstraintsBufferCL));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(2, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(3, mArena->mPositionCorrectionsBufferCL));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(4, mArena->mActiveStretchConstraintsBufferCL));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(5, useActiveIDs));
+                OCL_CALL(mCalcStretchPositionCorrections->setArg(6, paramsSize, params));
+
+                if (mArena->numBendConstraints() > 0) {
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(0, mArena->mVertexClothBufferCL));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(1, mArena->mBendConstraintsBufferCL));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(2, mArena->mPredictedPositionsBufferCL));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(3, mArena->mPositionCorrectionsBufferCL));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(4, mArena->mActiveBendConstraintsBufferCL));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(5, useActiveIDs));
+                    OCL_CALL(mCalcBendPositionCorrections->setArg(6, paramsSize, params));
+                }
+
+                if (usePartitionedProjection()) {
+                    const ::size_t maxVertices = mArena->maxPartitionVertices();
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(0, mArena->mVertexClothBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(1, mArena->mStretchConstraintsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(2, mArena->mBendConstraintsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(3, mArena->mPartitionsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(4, mArena->mPartitionVerticesBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(5, mArena->mPartitionStretchConstraintsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(6, mArena->mPartitionBendConstraintsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(7, mArena->mPredictedPositionsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(8, mArena->mPositionCorrectionsBufferCL));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(9, cl::Local(sizeof(cl_float3) * maxVertices)));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(10, cl::Local(sizeof(cl_float) * maxVertices)));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(11, cl::Local(sizeof(cl_float3) * maxVertices)));
+                    OCL_CALL(mCalcPartitionPositionCorrections->setArg(13, paramsSize, params));
+                }
+
+                OCL_CALL(mCorrectPredictions->setArg(0, mArena->mPositionCorrectionsBufferCL));
+                OCL_CALL(mCorrectPredictions->setArg(1, mArena->mPredictedPositionsBufferCL));
+                OCL_CALL(mCorrectPredictions->setArg(2, mArena->mPreviousPredictedBufferCL));
+                OCL_CALL(mCorrectPredictions->setArg(3, 1.0f));
+                OCL_CALL(mCorrectPredictions->setArg(4, mArena->mActiveVerticesBufferCL));
+                OCL_CALL(mCorrectPredictions->setArg(5, useActiveIDs));
+                OCL_CALL(mCorrectPredictions->setArg(6, paramsSize, params));
+                break;
+        }
+    }
+
+    bool ClothSimulationScene::usePartitionedProjection() const {
+        if (!mParams.usePartitions || !mCalcPartitionPositionCorrections || mArena->numPartitions() == 0) {
+            return false;
+        }
+
+        // the partitions run over all of their constraints, asleep or not
+        if (mIsAnyClusterAsleep) return false;
+
+        const cl_ulong localBytes = mArena->maxPartitionVertices() * (2 * sizeof(cl_float3) + sizeof(cl_float));
+        return localBytes <= mLocalMemSize;
+    }
+
+    bool ClothSimulationScene::trySolveInLocalMemory() {
+        if (!mParams.useLocalSolver || !mSolveClothLocal) return false;
+
+        // the local memory solver is the colored Gauss-Seidel solver, the other modes keep their own kernels
+        if (mParams.solverMode != SolverMode::GAUSS_SEIDEL_COLORED) return false;
+
+        // ... and runs every substep in one launch, so it can't stop early after a convergence check
+        if (mParams.convergenceCheckInterval > 0) return false;
+
+        // ... and runs over every vertex, asleep or not
+        if (mIsAnyClusterAsleep) return false;
+
+        // ... and has no collisions between the substeps
+        if (!mCollisionVertexRanges.empty() && mParams.collideEverySubStep) return false;
+        if (mSdfColliders) return false;
+
+        // ... and has no coarse multigrid levels
+        for (uint k = 0; k < mClothMeshes.size(); ++k) {
+            if (mClothMeshes[k]->mUseMultigrid && mArena->numMultigridLevels(k) > 0) return false;
+        }
+
+        // the local buffers are sized for the largest cloth
+        cl_ulong maxVertices = 0, maxEdges = 0;
+        for (const auto &range : mArena->mClothRanges) {
+            maxVertices = std::max<cl_ulong>(maxVertices, range.numVertices);
+            maxEdges = std::max<cl_ulong>(maxEdges, range.numEdges);
+        }
+
+        const cl_ulong vertexBytes = maxVertices * (sizeof(cl_float3) + sizeof(cl_float));
+        const cl_ulong restDataBytes = maxEdges * 2 * sizeof(cl_float);
+        if (vertexBytes > mLocalMemSize) return false;
+
+        // the edge rest data is read from global memory if it doesn't fit as well
+        const bool cacheRestData = vertexBytes + restDataBytes <= mLocalMemSize;
+        const ::size_t restDataSize = cacheRestData ? sizeof(cl_float) * maxEdges : sizeof(cl_float);
+
+        OCL_CALL(mSolveClothLocal->setArg(0, mArena->mVertexClothBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(1, mArena->mEdgeBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(2, mArena->mEdgeClothBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(3, mArena->mClothRangesBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(4, mArena->mEdgeBatchOffsetsBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(5, static_cast<cl_uint>(mArena->numCloths())));
+        OCL_CALL(mSolveClothLocal->setArg(6, static_cast<cl_uint>(mArena->numEdgeColors())));
+        OCL_CALL(mSolveClothLocal->setArg(7, mArena->mPredictedPositionsBufferCL));
+        OCL_CALL(mSolveClothLocal->setArg(8, cl::Local(sizeof(cl_float3) * maxVertices)));
+        OCL_CALL(mSolveClothLocal->setArg(9, cl::Local(sizeof(cl_float) * maxVertices)));
+        OCL_CALL(mSolveClothLocal->setArg(10, cl::Local(restDataSize)));
+        OCL_CALL(mSolveClothLocal->setArg(11, cl::Local(restDataSize)));
+        OCL_CALL(mSolveClothLocal->setArg(12, static_cast<cl_uint>(cacheRestData)));
+        OCL_CALL(mSolveClothLocal->setArg(13, sizeof(ClothSimParams), (const void *) &mStepParams));
+        OCL_CALL(mSolveClothLocal->setArg(14, *mColliderPrimitivesCL));
+        OCL_CALL(mSolveClothLocal->setArg(15, mNumColliderPrimitives));
+
+        ++mNumKernelLaunches;
+        OCL_CALL(mQueue.enqueueNDRangeKernel(*mSolveClothLocal, cl::NullRange,
+                                             cl::NDRange(mArena->numCloths() * mLocalSolverWorkGroupSize),
+                                             cl::NDRange(mLocalSolverWorkGroupSize)));
+        return true;
+    }
+
     void ClothSimulationScene::render() {
         const glm::mat4 VP = mCamera->getPerspectiveTransform() * glm::inverse(mCamera->getTransform());
         const glm::vec4 WorldEye = mCamera->getParent()->getTransform() * glm::vec4(mCamera->getPosition(), 1.0f);
@@ -273,10 +1254,11 @@ namespace pbd {
         for (auto renderObject : mRenderObjects) {
             renderObject->render(VP);
         }
-        if (mIsGrabbingCloth) {
-            Vertex vertex;
-            mQueue.enqueueReadBuffer(mGrabbedClothMesh->mVertexBufferCL, true, sizeof(Vertex) * mGrabbedVertexIndex, sizeof(Vertex), &vertex);
-            auto position = vertex.position;
+        if (mIsGrabbingCloth && mArena) {
+            glm::vec4 vertexPosition;
+            mQueue.enqueueReadBuffer(mArena->mPositionsBufferCL, true, sizeof(cl_float3) * mGrabbedVertexIndex,
+                                     sizeof(cl_float3), &vertexPosition);
+            auto position = glm::vec3(vertexPosition);
             position.y = -position.y;
             mMarker->setPosition(position);
             mMarker->render(VP);
@@ -324,44 +1306,42 @@ namespace pbd {
             rayOriginCL.s[i] = rayOrigin[i];
         }
 
-        std::shared_ptr<ClothMesh> closestcloth = nullptr;
+        if (!mArena) {
+            return false;
+        }
+
         std::vector<cl_float> distances;
         int closestindex = -1;
         float closestdistance = 1e10;
 
-        for (auto &clothmesh : mClothMeshes) {
-            OCL_CALL(mCalcDistToLine->setArg(0, clothmesh->mVertexBufferCL));
-            OCL_CALL(mCalcDistToLine->setArg(1, clothmesh->mDistToLineBufferCL));
-            OCL_CALL(mCalcDistToLine->setArg(2, rayOriginCL));
-            OCL_CALL(mCalcDistToLine->setArg(3, rayWorldCL));
-            ENQUEUE_VERTICES(mCalcDistToLine, clothmesh);
+        OCL_CALL(mCalcDistToLine->setArg(0, mArena->mPositionsBufferCL));
+        OCL_CALL(mCalcDistToLine->setArg(1, mArena->mDistToLineBufferCL));
+        OCL_CALL(mCalcDistToLine->setArg(2, rayOriginCL));
+        OCL_CALL(mCalcDistToLine->setArg(3, rayWorldCL));
+        ENQUEUE_VERTICES(mCalcDistToLine, mArena);
 
-            distances.reserve(clothmesh->numVertices());
-            mQueue.enqueueReadBuffer(clothmesh->mDistToLineBufferCL, true, 0,
-                                     sizeof(cl_float) * clothmesh->numVertices(), distances.data());
+        distances.resize(mArena->numVertices());
+        mQueue.enqueueReadBuffer(mArena->mDistToLineBufferCL, true, 0,
+                                 sizeof(cl_float) * mArena->numVertices(), distances.data());
 
-            for (uint i = 0; i < clothmesh->numVertices(); ++i) {
-                std::cout << distances[i] << ", ";
-                if (distances[i] < closestdistance) {
-
-                    closestcloth = clothmesh;
-                    closestdistance = distances[i];
-                    closestindex = i;
-                }
-                std::cout << std::endl;
+        for (uint i = 0; i < mArena->numVertices(); ++i) {
+            if (distances[i] < closestdistance) {
+                closestdistance = distances[i];
+                closestindex = i;
             }
         }
 
-        if (closestcloth) {
+        if (closestindex != -1) {
             mIsGrabbingCloth = true;
-            mGrabbedClothMesh = closestcloth;
             mGrabbedVertexIndex = static_cast<uint>(closestindex);
-            std::cout << "Grabbed vertex index = " << mGrabbedVertexIndex << " at distance = " << closestdistance << std::endl;
+            std::cout << "Grabbed vertex index = " << mGrabbedVertexIndex
+                      << " of cloth " << mArena->findCloth(mGrabbedVertexIndex)
+                      << " at distance = " << closestdistance << std::endl;
 
             if (modifiers == GLFW_MOD_SHIFT) {
                 // pin this vertex
                 cl_float invmass_ = 0.0f;
-                OCL_CALL(mQueue.enqueueWriteBuffer(mGrabbedClothMesh->mVertexClothBufferCL, true,
+                OCL_CALL(mQueue.enqueueWriteBuffer(mArena->mVertexClothBufferCL, true,
                                                    sizeof(ClothVertexData) * mGrabbedVertexIndex + offsetof(ClothVertexData, invmass),
                                                    sizeof(cl_float), &invmass_));
             }
@@ -427,30 +1407,139 @@ namespace pbd {
                                                                     CL_ERROR));
         OCL_CHECK(mSetPositionsToPredicted = util::make_unique<cl::Kernel>(*mPredictPositionsProgram,
                                                                            "set_positions_to_predicted", CL_ERROR));
+        OCL_CHECK(mCopyPositionsToVertices = util::make_unique<cl::Kernel>(*mPredictPositionsProgram,
+                                                                           "copy_positions_to_vertices", CL_ERROR));
+        OCL_CHECK(mCalcClusterSpeeds = util::make_unique<cl::Kernel>(*mPredictPositionsProgram,
+                                                                     "calc_cluster_speeds", CL_ERROR));
+        OCL_CHECK(mCountCalmFrames = util::make_unique<cl::Kernel>(*mPredictPositionsProgram,
+                                                                   "count_calm_frames", CL_ERROR));
+        OCL_CHECK(mCalcClothBounds = util::make_unique<cl::Kernel>(*mPredictPositionsProgram,
+                                                                   "calc_cloth_bounds", CL_ERROR));
+
+        // the bounds reduction needs a power-of-two work-group size
+        const ::size_t maxBoundsWorkGroupSize = std::min<::size_t>(
+                256, mCalcClothBounds->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(mDevice));
+        mBoundsWorkGroupSize = 1;
+        while (2 * mBoundsWorkGroupSize <= maxBoundsWorkGroupSize) mBoundsWorkGroupSize *= 2;
+
+        mCountingSortProgram = util::LoadCLProgram("counting_sort.cl", mContext, mDevice);
+        OCL_CHECK(mInsertParticles = util::make_unique<cl::Kernel>(*mCountingSortProgram,
+                                                                   "insert_particles", CL_ERROR));
+        OCL_CHECK(mSortParticles = util::make_unique<cl::Kernel>(*mCountingSortProgram,
+                                                                 "sort_particles", CL_ERROR));
+        OCL_CHECK(mCollideParticles = util::make_unique<cl::Kernel>(*mCountingSortProgram,
+                                                                    "collide_particles", CL_ERROR));
+
+        mSdfCollisionProgram = util::LoadCLProgram("sdf_collision.cl", mContext, mDevice);
+        OCL_CHECK(mCollideSdfs = util::make_unique<cl::Kernel>(*mSdfCollisionProgram, "collide_sdfs", CL_ERROR));
 
         mClothSimulationProgram = util::LoadCLProgram("cloth_simulation.cl", mContext, mDevice);
-        OCL_CHECK(mCalcClothMass = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        createSolverKernels(mClothSimulationProgram);
+
+        /// specialized variants are compiled from the reloaded source when they are needed again
+        mSolverVariants = util::make_unique<util::SpecializationCache>(mContext, mDevice, "cloth_simulation.cl");
+
+        /// the local memory solver is used for every cloth whose state fits in local memory
+        mLocalMemSize = mDevice.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+    }
+
+    void ClothSimulationScene::createSolverKernels(const std::shared_ptr<cl::Program> &program) {
+        if (!program) return;
+
+        OCL_ERROR;
+
+        OCL_CHECK(mCalcClothMass = util::make_unique<cl::Kernel>(*program,
                                                                  "calc_cloth_mass",
                                                                  CL_ERROR));
-        OCL_CHECK(mCalcInverseMass = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        OCL_CHECK(mCalcInverseMass = util::make_unique<cl::Kernel>(*program,
                                                                    "calc_inverse_mass",
                                                                    CL_ERROR));
-        OCL_CHECK(mCalcEdgeProperties = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        OCL_CHECK(mCalcEdgeProperties = util::make_unique<cl::Kernel>(*program,
                                                                       "calc_edge_properties",
                                                                       CL_ERROR));
-        OCL_CHECK(mFixVertex = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        OCL_CHECK(mCalcStretchRestLengths = util::make_unique<cl::Kernel>(*program,
+                                                                          "calc_stretch_rest_lengths",
+                                                                          CL_ERROR));
+        OCL_CHECK(mCalcBendRestAngles = util::make_unique<cl::Kernel>(*program,
+                                                                      "calc_bend_rest_angles",
+                                                                      CL_ERROR));
+        OCL_CHECK(mFixVertex = util::make_unique<cl::Kernel>(*program,
                                                              "fix_vertex",
                                                              CL_ERROR));
-        OCL_CHECK(mClipToPlanes = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        OCL_CHECK(mClipToPlanes = util::make_unique<cl::Kernel>(*program,
                                                                 "clip_to_planes",
                                                                 CL_ERROR));
-        OCL_CHECK(mCalcPositionCorrections = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
-                                                                           "calc_position_corrections",
-                                                                           CL_ERROR));
-        OCL_CHECK(mCorrectPredictions = util::make_unique<cl::Kernel>(*mClothSimulationProgram,
+        OCL_CHECK(mCalcStretchPositionCorrections = util::make_unique<cl::Kernel>(*program,
+                                                                                  "calc_stretch_position_corrections",
+                                                                                  CL_ERROR));
+        OCL_CHECK(mCalcBendPositionCorrections = util::make_unique<cl::Kernel>(*program,
+                                                                               "calc_bend_position_corrections",
+                                                                               CL_ERROR));
+        OCL_CHECK(mCalcPartitionPositionCorrections = util::make_unique<cl::Kernel>(*program,
+                                                                                    "calc_partition_position_corrections",
+                                                                                    CL_ERROR));
+        OCL_CHECK(mCorrectPredictions = util::make_unique<cl::Kernel>(*program,
                                                                       "correct_predictions",
                                                                       CL_ERROR));
+        OCL_CHECK(mProjectConstraintsColored = util::make_unique<cl::Kernel>(*program,
+                                                                             "project_constraints_colored",
+                                                                             CL_ERROR));
+        OCL_CHECK(mProjectConstraintsXPBD = util::make_unique<cl::Kernel>(*program,
+                                                                          "project_constraints_xpbd",
+                                                                          CL_ERROR));
+        OCL_CHECK(mCalcConstraintDeltas = util::make_unique<cl::Kernel>(*program,
+                                                                        "calc_constraint_deltas",
+                                                                        CL_ERROR));
+        OCL_CHECK(mGatherPositionCorrections = util::make_unique<cl::Kernel>(*program,
+                                                                             "gather_position_corrections",
+                                                                             CL_ERROR));
+        OCL_CHECK(mRestrictPositions = util::make_unique<cl::Kernel>(*program,
+                                                                     "restrict_positions",
+                                                                     CL_ERROR));
+        OCL_CHECK(mProjectLevelConstraints = util::make_unique<cl::Kernel>(*program,
+                                                                           "calc_stretch_position_corrections",
+                                                                           CL_ERROR));
+        OCL_CHECK(mCorrectLevelPredictions = util::make_unique<cl::Kernel>(*program,
+                                                                           "correct_level_predictions",
+                                                                           CL_ERROR));
+        OCL_CHECK(mProlongCorrections = util::make_unique<cl::Kernel>(*program,
+                                                                      "prolong_corrections",
+                                                                      CL_ERROR));
+        OCL_CHECK(mCalcConstraintViolation = util::make_unique<cl::Kernel>(*program,
+                                                                           "calc_constraint_violation",
+                                                                           CL_ERROR));
+        OCL_CHECK(mSolveClothLocal = util::make_unique<cl::Kernel>(*program,
+                                                                   "solve_cloth_local",
+                                                                   CL_ERROR));
+
+        mLocalSolverWorkGroupSize = mSolveClothLocal->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(mDevice);
+
+        // a partition has around 3 stretch constraints per owned vertex, so one work-item per owned vertex
+        mPartitionWorkGroupSize = std::min<::size_t>(
+                ClothArena::PARTITION_SIZE,
+                mCalcPartitionPositionCorrections->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(mDevice));
 
+        // the violation reduction needs a power-of-two work-group size
+        const ::size_t maxViolationWorkGroupSize = std::min<::size_t>(
+                256, mCalcConstraintViolation->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(mDevice));
+        mViolationWorkGroupSize = 1;
+        while (2 * mViolationWorkGroupSize <= maxViolationWorkGroupSize) mViolationWorkGroupSize *= 2;
+        mActiveSolverProgram = program;
+    }
+
+    void ClothSimulationScene::updateSolverProgram() {
+        std::shared_ptr<cl::Program> program = mClothSimulationProgram;
+
+        if (mSpecializeKernels && mSolverVariants) {
+            auto variant = mSolverVariants->get(mStepParams.getDefinesCL(), mFastMath ? "-cl-fast-relaxed-math" : "");
+
+            // the generic program is used while the variant for the current parameters compiles
+            if (variant) program = variant;
+        }
+
+        if (program != mActiveSolverProgram) {
+            createSolverKernels(program);
+        }
     }
 
     void ClothSimulationScene::loadSetup() {
@@ -474,20 +1563,24 @@ namespace pbd {
             mShaders[config.name] = shader;
         }
 
+        std::vector<SignedDistanceField> colliderFields;
+
         for (const MeshConfig &meshconfig : mCurrentSetup.meshes) {
             std::shared_ptr<pbd::Mesh> mesh = nullptr;
             std::shared_ptr<ClothMesh> cloth = nullptr;
 
+            // the same transform as the render object of a static mesh
+            const glm::mat4 rotation = glm::toMat4(glm::quat(meshconfig.orientation));
+            const glm::mat4 translation = glm::translate(glm::mat4(1.0f), meshconfig.position);
+            const glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(meshconfig.scale));
+            const glm::mat4 transform = translation * rotation * scale;
+
             if (meshconfig.isCloth) {
-                cloth = MeshLoader::LoadClothMesh(RESOURCEPATH(meshconfig.path));
+                cloth = MeshLoader::LoadClothMesh(RESOURCEPATH(meshconfig.path), meshconfig.multigridLevels,
+                                                  VertexOrdering::Parse(meshconfig.vertexOrder));
                 mClothMeshes.push_back(cloth);
 
                 // pre-process each vertex with its transform matrix
-                const glm::mat4 rotation = glm::toMat4(glm::quat(meshconfig.orientation));
-                const glm::mat4 translation = glm::translate(glm::mat4(1.0f), meshconfig.position);
-                const glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(meshconfig.scale));
-
-                const glm::mat4 transform = translation * rotation * scale;
                 const glm::mat3 normalTransform(transform);
 
                 for (auto &vertex : cloth->mVertices) {
@@ -504,48 +1597,34 @@ namespace pbd {
                 mesh = cloth;
             } else {
                 mesh = MeshLoader::LoadMesh(RESOURCEPATH(meshconfig.path));
+
+                /// static meshes with a cell size collide with the cloths through their baked distance field
+                if (meshconfig.sdfCellSize > 0.0f) {
+                    std::vector<glm::vec3> positions;
+                    positions.reserve(mesh->mVertices.size());
+                    for (const auto &vertex : mesh->mVertices) {
+                        positions.push_back(glm::vec3(transform * glm::vec4(vertex.position, 1.0f)));
+                    }
+                    colliderFields.push_back(SignedDistanceField::LoadOrBake(positions, mesh->mTriangles,
+                                                                             meshconfig.sdfCellSize,
+                                                                             meshconfig.sdfBandWidth,
+                                                                             meshconfig.flipNormals));
+                }
             }
 
             mesh->uploadHostData();
             mesh->generateBuffersCL(mContext);
-            mesh->clearHostData();
+
+            // the host data of cloths is cleared once it has been packed into the arena
+            if (!cloth) {
+                mesh->clearHostData();
+            }
 
             // Add these OpenGL memory objects to a vector for easy acquire/release
             auto memObjects = mesh->getMemoryCL();
             mMemObjects.insert(mMemObjects.end(), memObjects.begin(), memObjects.end());
             memObjects.clear();
 
-            /// Calculate initial values for this cloth mesh
-            if (cloth) {
-                auto memory = cloth->getMemoryCL();
-                OCL_CALL(mQueue.enqueueAcquireGLObjects(&memory));
-
-                /// kernels/cloth_simulation.cl -> calc_cloth_mass
-                OCL_CALL(mCalcClothMass->setArg(0, cloth->mVertexBufferCL));
-                OCL_CALL(mCalcClothMass->setArg(1, cloth->mVertexClothBufferCL));
-                OCL_CALL(mCalcClothMass->setArg(2, cloth->mTriangleBufferCL));
-                OCL_CALL(mCalcClothMass->setArg(3, cloth->mTriangleClothBufferCL));
-                ENQUEUE_TRIANGLES(mCalcClothMass, cloth);
-
-                /// kernels/cloth_simulation.cl -> calc_inverse_mass
-                OCL_CALL(mCalcInverseMass->setArg(0, cloth->mVertexClothBufferCL));
-                ENQUEUE_VERTICES(mCalcInverseMass, cloth);
-
-                //OCL_CALL(mFixVertex->setArg(0, cloth->mVertexClothBufferCL));
-                //OCL_CALL(mFixVertex->setArg(1, 0));
-                //ENQUEUE_VERTICES(mFixVertex, cloth);
-
-                /// kernels/cloth_simulation.cl -> calc_edge_properties
-                OCL_CALL(mCalcEdgeProperties->setArg(0, cloth->mVertexBufferCL));
-                OCL_CALL(mCalcEdgeProperties->setArg(1, cloth->mTriangleBufferCL));
-                OCL_CALL(mCalcEdgeProperties->setArg(2, cloth->mEdgeBufferCL));
-                OCL_CALL(mCalcEdgeProperties->setArg(3, cloth->mEdgeClothBufferCL));
-                OCL_CALL(mCalcEdgeProperties->setArg(4, cloth->mTriangleClothBufferCL));
-                ENQUEUE_EDGES(mCalcEdgeProperties, cloth);
-
-                OCL_CALL(mQueue.enqueueReleaseGLObjects(&memory));
-            }
-
             auto shader = mShaders[meshconfig.shader];
 
             auto meshobject = std::make_shared<clgl::MeshObject>(mesh, shader);
@@ -558,6 +1637,108 @@ namespace pbd {
             mRenderObjects.push_back(meshobject);
         }
 
+        if (!colliderFields.empty()) {
+            mSdfColliders = util::make_unique<SdfColliders>(mContext, colliderFields);
+        }
+
+        /// a setup without analytic colliders only has the ground plane
+        std::vector<ColliderPrimitive> primitives;
+        for (const ColliderConfig &config : mCurrentSetup.colliders) {
+            ColliderPrimitive primitive;
+            if (ToColliderPrimitive(config, primitive)) {
+                primitives.push_back(primitive);
+            } else {
+                displayError("Unknown collider type " + config.type);
+            }
+        }
+        mHasSetupColliders = !mCurrentSetup.colliders.empty();
+        if (primitives.empty()) {
+            ColliderConfig ground;
+            ground.type = "PLANE";
+            ground.position = glm::vec3(0.0f, 0.02f, 0.0f);
+            ground.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            ground.orientation = glm::vec3(0.0f);
+            ground.radius = 0.0f;
+
+            ColliderPrimitive primitive;
+            ToColliderPrimitive(ground, primitive);
+            primitives.push_back(primitive);
+        }
+        mNumColliderPrimitives = static_cast<uint>(primitives.size());
+
+        OCL_ERROR;
+        OCL_CHECK(mColliderPrimitivesCL = util::make_unique<cl::Buffer>(mContext,
+                                                                        CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                                        sizeof(ColliderPrimitive) * primitives.size(),
+                                                                        primitives.data(), CL_ERROR));
+
+        /// Pack all cloths into shared buffers and calculate their initial values
+        if (!mClothMeshes.empty()) {
+            mArena = util::make_unique<ClothArena>(mContext, mClothMeshes);
+            for (auto &cloth : mClothMeshes) {
+                cloth->clearHostData();
+            }
+
+            /// every cloth starts awake
+            mCalmFrames.assign(mArena->numSleepClusters(), 0);
+            mIsClusterAsleep.assign(mArena->numSleepClusters(), false);
+            mIsAnyClusterAsleep = false;
+            mHasCalmFrames = false;
+            mSleepParams = mParams;
+
+            /// no cloths collide until the first bounds check
+            mClothBounds.assign(8 * (mArena->numCloths() + 1), 0);
+            mHasClothBounds = false;
+            mClothPairs.assign(mArena->numCloths() * mArena->numCloths(), 0);
+
+            /// sorts the collision vertices by bin if useRadixSort, see #enqueueCollisions
+            mParticleSort = util::make_unique<util::RadixSort>(mContext, mDevice,
+                                                               static_cast<uint>(mArena->numVertices()));
+
+            /// the BVH is built in the first frame that uses it
+            mTriangleBVH = util::make_unique<TriangleBVH>(mContext, mDevice,
+                                                          static_cast<uint>(mArena->numTriangles()));
+
+            /// kernels/cloth_simulation.cl -> calc_cloth_mass
+            OCL_CALL(mCalcClothMass->setArg(0, mArena->mPositionsBufferCL));
+            OCL_CALL(mCalcClothMass->setArg(1, mArena->mVertexClothBufferCL));
+            OCL_CALL(mCalcClothMass->setArg(2, mArena->mTriangleBufferCL));
+            OCL_CALL(mCalcClothMass->setArg(3, mArena->mTriangleClothBufferCL));
+            ENQUEUE_TRIANGLES(mCalcClothMass, mArena);
+
+            /// kernels/cloth_simulation.cl -> calc_inverse_mass
+            OCL_CALL(mCalcInverseMass->setArg(0, mArena->mVertexClothBufferCL));
+            ENQUEUE_VERTICES(mCalcInverseMass, mArena);
+
+            //OCL_CALL(mFixVertex->setArg(0, mArena->mVertexClothBufferCL));
+            //OCL_CALL(mFixVertex->setArg(1, 0));
+            //ENQUEUE_VERTICES(mFixVertex, mArena);
+
+            /// kernels/cloth_simulation.cl -> calc_edge_properties
+            OCL_CALL(mCalcEdgeProperties->setArg(0, mArena->mPositionsBufferCL));
+            OCL_CALL(mCalcEdgeProperties->setArg(1, mArena->mEdgeBufferCL));
+            OCL_CALL(mCalcEdgeProperties->setArg(2, mArena->mEdgeClothBufferCL));
+            ENQUEUE_EDGES(mCalcEdgeProperties, mArena);
+
+            /// kernels/cloth_simulation.cl -> calc_stretch_rest_lengths, calc_bend_rest_angles
+            OCL_CALL(mCalcStretchRestLengths->setArg(0, mArena->mPositionsBufferCL));
+            OCL_CALL(mCalcStretchRestLengths->setArg(1, mArena->mStretchConstraintsBufferCL));
+            ENQUEUE_STRETCH_CONSTRAINTS(mCalcStretchRestLengths, mArena);
+
+            if (mArena->numBendConstraints() > 0) {
+                OCL_CALL(mCalcBendRestAngles->setArg(0, mArena->mPositionsBufferCL));
+                OCL_CALL(mCalcBendRestAngles->setArg(1, mArena->mBendConstraintsBufferCL));
+                ENQUEUE_BEND_CONSTRAINTS(mCalcBendRestAngles, mArena);
+            }
+
+            if (mArena->numMultigridLevels() > 0) {
+                const uint numLevelConstraints = mArena->levelConstraintBegin(
+                        static_cast<uint>(mArena->numMultigridLevels()), static_cast<uint>(mArena->numCloths()));
+                OCL_CALL(mCalcStretchRestLengths->setArg(1, mArena->mLevelConstraintsBufferCL));
+                ENQUEUE_RANGE(mCalcStretchRestLengths, 0, numLevelConstraints);
+            }
+        }
+
         for (const PointLightConfig &config : mCurrentSetup.pointLights) {
             auto pointLight = std::make_shared<clgl::PointLight>();
             pointLight->mAmbientColor = config.color.ambient;
@@ -687,6 +1868,52 @@ namespace pbd {
         double FPS = mFramesSinceLastUpdate / timeSinceLastUpdate;
         ss << "Average FPS: " << std::setprecision(3) << FPS;
         mLabelFPS->setCaption(ss.str());
+
+        ss.str("");
+
+        ss << "Kernel launches/frame: " << mNumKernelLaunches;
+        mLabelKernelLaunches->setCaption(ss.str());
+
+        ss.str("");
+
+        const std::string fusionBlocker = findSubStepFusionBlocker();
+        ss << "Fused substeps: ";
+        if (!mParams.fuseSubSteps) {
+            ss << "off";
+        } else if (fusionBlocker.empty()) {
+            ss << "on";
+        } else {
+            ss << "inactive, " << fusionBlocker;
+        }
+        mLabelSubStepFusion->setCaption(ss.str());
+
+        ss.str("");
+
+        ss << "Substeps/frame: " << mSubStepsUsed << "/" << mParams.numSubSteps;
+        if (mParams.convergenceCheckInterval > 0 && mArena) {
+            const double rmsStrain = std::sqrt(mViolation[1] / mArena->numStretchConstraints());
+            ss << " (stretch max " << std::setprecision(3) << mViolation[0] << ", RMS " << rmsStrain << ")";
+        }
+        mLabelSubSteps->setCaption(ss.str());
+
+        ss.str("");
+
+        if (mParams.useSelfCollision || mParams.useClothCollision) {
+            ss << "Collision ms/frame: bin " << std::setprecision(3) << mCollisionTimes[COLLISION_BIN]
+               << ", scan " << mCollisionTimes[COLLISION_SCAN]
+               << ", sort " << mCollisionTimes[COLLISION_SORT]
+               << ", resolve " << mCollisionTimes[COLLISION_RESOLVE];
+        }
+        mLabelCollisionTimes->setCaption(ss.str());
+
+        ss.str("");
+
+        if (mParams.useTriangleBVH && mTriangleBVH) {
+            ss << "BVH ms/frame: build " << std::setprecision(3) << mBVHBuildTime
+               << ", refit " << mBVHRefitTime
+               << " (" << mTriangleBVH->numBuilds() << " builds)";
+        }
+        mLabelBVHTimes->setCaption(ss.str());
     }
 
     void ClothSimulationScene::displayError(const std::string &str) {
@@ -17,6 +17,13 @@
 
 #include <simulation/Grid.hpp>
 #include <simulation/ClothSimParams.hpp>
+#include <simulation/ClothArena.hpp>
+#include <simulation/SdfColliders.hpp>
+#include <simulation/TriangleBVH.hpp>
+
+#include <util/PrefixScan.hpp>
+#include <util/RadixSort.hpp>
+#include <util/SpecializationCache.hpp>
 
 namespace pbd {
     /// @brief //todo add brief description to FluidScene
@@ -54,12 +61,127 @@ namespace pbd {
 
         void loadKernels();
 
+        /**
+         * Creates the cloth simulation kernels from a (generic or specialized) variant of kernels/cloth_simulation.cl
+         */
+        void createSolverKernels(const std::shared_ptr<cl::Program> &program);
+
+        /**
+         * Switches to the specialized variant of the solver program for the current parameters if it is
+         * compiled, otherwise to the generic program. Missing variants are compiled in the background.
+         */
+        void updateSolverProgram();
+
         void loadSetup();
 
         void displayError(const std::string &str = "");
 
         void renderAxes();
 
+        /**
+         * Runs all substeps of constraint projection for every cloth, with the current solver mode.
+         */
+        void projectConstraints();
+
+        /**
+         * Returns why the projection kernels can't clip to the ground as they read the predicted positions
+         * this frame, or an empty string if fuseSubSteps can be applied.
+         */
+        std::string findSubStepFusionBlocker() const;
+
+        /**
+         * Sets the arguments of the kernels used by #projectConstraints.
+         */
+        void setProjectionArgs();
+
+        /**
+         * Enqueues the reduction of the constraint violation and a non-blocking read of
+         * the result into mViolation, which is ready once mViolationReadEvent has completed.
+         */
+        void enqueueViolationCheck();
+
+        /**
+         * Runs all substeps with one work-group per cloth in local memory, if every
+         * cloth is small enough to fit in the device's local memory.
+         * @return true if the cloths were solved, false if they have to be solved by #projectConstraints
+         */
+        bool trySolveInLocalMemory();
+
+        /**
+         * Returns true if the JACOBI_ATOMIC corrections are calculated per constraint partition, which
+         * needs every partition to fit in the device's local memory and every sleep cluster to be awake.
+         */
+        bool usePartitionedProjection() const;
+
+        /**
+         * Enqueues a multigrid V-cycle over the coarse levels of every cloth that has
+         * them and uses them (see ClothMesh::mUseMultigrid), ending on the finest level.
+         */
+        void enqueueMultigridVCycles();
+
+        /**
+         * Enqueues steps Jacobi iterations of the constraints of coarse multigrid level l of cloth k.
+         */
+        void smoothMultigridLevel(uint level, uint cloth, uint steps);
+
+        /**
+         * Decides which sleep clusters (see ClothArena) sleep in this frame, from the calm frames of
+         * the last completed sleep check, and rebuilds the active element lists if that changed.
+         * Clusters wake up when a neighbour moves, when they are grabbed, and when a parameter changes.
+         */
+        void updateSleepState();
+
+        /**
+         * Enqueues the counting of the calm frames of every sleep cluster and a non-blocking read of
+         * the result into mCalmFrames, which is ready once mCalmFramesReadEvent has completed.
+         */
+        void enqueueSleepCheck();
+
+        /**
+         * Returns true if every sleep cluster of cloth k is asleep.
+         */
+        bool isClothAsleep(uint cloth) const;
+
+        /**
+         * Decides which cloths collide in this frame: every cloth with itself with useSelfCollision, and with
+         * useClothCollision the pairs of cloths whose bounds from the last completed bounds check, grown by the
+         * distance that they can move in a frame, overlap. Uploads the pairs if they changed and collects the
+         * vertices of the cloths that collide with anything into mCollisionVertexRanges.
+         */
+        void updateCollisionPairs();
+
+        /**
+         * Enqueues the reduction of the bounds of every cloth and of the scene and a non-blocking read of the
+         * result into mClothBounds, which is ready once mClothBoundsReadEvent has completed.
+         */
+        void enqueueClothBoundsCheck();
+
+        /**
+         * Sets up mGridCL for the next collisions, and grows its bin buffers if it has more bins than they fit.
+         * With useAdaptiveGrid the bin size follows the mean rest edge length of mArena, and a bounded grid is
+         * fitted to the bounds of the scene from the last completed bounds check.
+         */
+        void updateGrid();
+
+        /**
+         * Sets the arguments of the kernels used by #enqueueCollisions.
+         */
+        void setCollisionArgs();
+
+        /**
+         * Enqueues the binning of the predicted positions of mCollisionVertexRanges into mGridCL with a
+         * counting sort, or a radix sort by bin and vertex ID if useRadixSort, and the resolution of the
+         * vertex-vertex contacts of the colliding cloth pairs within the 27 bins around every active vertex.
+         * The launch events of each stage are kept for #readDeviceTimes.
+         */
+        void enqueueCollisions();
+
+        /**
+         * Sums the device times of the collision stages and the BVH update of the finished frame
+         * into mCollisionTimes, mBVHBuildTime and mBVHRefitTime.
+         */
+        void readDeviceTimes();
+
         std::shared_ptr<clgl::BaseShader> mAxisShader;
         std::shared_ptr<bwgl::VertexBuffer> mAxisPositions;
         std::shared_ptr<bwgl::VertexBuffer> mAxisColors;
@@ -77,6 +199,13 @@ namespace pbd {
         std::vector<std::shared_ptr<clgl::RenderObject>> mRenderObjects;
 
         std::vector<std::shared_ptr<pbd::ClothMesh>> mClothMeshes;
+        std::unique_ptr<pbd::ClothArena> mArena;
+        std::unique_ptr<pbd::SdfColliders> mSdfColliders; // static meshes with an sdfCellSize, see MeshConfig
+
+        /// Analytic colliders of the setup (or the ground plane), in constant memory of clip_to_planes
+        std::unique_ptr<cl::Buffer> mColliderPrimitivesCL;
+        uint mNumColliderPrimitives;
+        bool mHasSetupColliders; // false if only the ground plane, which fuseSubSteps folds into the projection
 
         std::map<std::string, std::shared_ptr<clgl::BaseShader>> mShaders;
 
@@ -87,8 +216,7 @@ namespace pbd {
         glm::ivec2 mCursorPosition;
         bool mIsRotatingCamera;
         bool mIsGrabbingCloth;
-        std::shared_ptr<pbd::ClothMesh> mGrabbedClothMesh;
-        uint mGrabbedVertexIndex;
+        uint mGrabbedVertexIndex; // index into the shared vertex buffers of mArena
 
         std::vector<cl::Memory> mMemObjects;
 
@@ -99,30 +227,107 @@ namespace pbd {
         ////////////////////////
 
         ClothSimParams mParams;
+        ClothSimParams mStepParams; // parameters of one integration step this frame, see ClothSimParams::getStepParams
 
         std::unique_ptr<cl::Program> mPredictPositionsProgram;
         std::unique_ptr<cl::Kernel> mCalcDistToLine;
         std::unique_ptr<cl::Kernel> mApplyGrabImpulse;
         std::unique_ptr<cl::Kernel> mPredictPositions;
         std::unique_ptr<cl::Kernel> mSetPositionsToPredicted;
+        std::unique_ptr<cl::Kernel> mCopyPositionsToVertices;
+        std::unique_ptr<cl::Kernel> mCalcClusterSpeeds;
+        std::unique_ptr<cl::Kernel> mCountCalmFrames;
+        std::unique_ptr<cl::Kernel> mCalcClothBounds;
 
-        std::unique_ptr<cl::Program> mClothSimulationProgram;
+        std::shared_ptr<cl::Program> mClothSimulationProgram; // generic, parameters are read from ClothSimParams
+        std::shared_ptr<cl::Program> mActiveSolverProgram;
+        std::unique_ptr<util::SpecializationCache> mSolverVariants;
+        bool mSpecializeKernels;
+        bool mFastMath;
 
         /// Cloth Mesh setup kernels ///
         std::unique_ptr<cl::Kernel> mCalcClothMass;
         std::unique_ptr<cl::Kernel> mCalcInverseMass;
         std::unique_ptr<cl::Kernel> mCalcEdgeProperties;
+        std::unique_ptr<cl::Kernel> mCalcStretchRestLengths;
+        std::unique_ptr<cl::Kernel> mCalcBendRestAngles;
 
         /// Position correction kernels ///
 
         std::unique_ptr<cl::Kernel> mFixVertex;
         std::unique_ptr<cl::Kernel> mClipToPlanes;
-        std::unique_ptr<cl::Kernel> mCalcPositionCorrections;
+        std::unique_ptr<cl::Kernel> mCalcStretchPositionCorrections;
+        std::unique_ptr<cl::Kernel> mCalcBendPositionCorrections;
+        std::unique_ptr<cl::Kernel> mCalcPartitionPositionCorrections;
         std::unique_ptr<cl::Kernel> mCorrectPredictions;
-
-        std::unique_ptr<pbd::Grid> mGridCL;
-        std::unique_ptr<cl::Buffer> mBinCountCL; // CxCxC-sized uint buffer, containing particle count per cell
+        std::unique_ptr<cl::Kernel> mProjectConstraintsColored;
+        std::unique_ptr<cl::Kernel> mProjectConstraintsXPBD;
+        std::unique_ptr<cl::Kernel> mCalcConstraintDeltas;
+        std::unique_ptr<cl::Kernel> mGatherPositionCorrections;
+        std::unique_ptr<cl::Kernel> mSolveClothLocal;
+        std::unique_ptr<cl::Kernel> mCalcConstraintViolation;
+
+        /// Multigrid kernels, mProjectLevelConstraints is calc_stretch_position_corrections
+        /// with the arguments of the coarse levels ///
+        std::unique_ptr<cl::Kernel> mRestrictPositions;
+        std::unique_ptr<cl::Kernel> mProjectLevelConstraints;
+        std::unique_ptr<cl::Kernel> mCorrectLevelPredictions;
+        std::unique_ptr<cl::Kernel> mProlongCorrections;
+
+        cl_ulong mLocalMemSize;
+        ::size_t mLocalSolverWorkGroupSize;
+        ::size_t mPartitionWorkGroupSize;
+        ::size_t mViolationWorkGroupSize;
+        ::size_t mBoundsWorkGroupSize;
+
+        cl_float mViolation[2]; // [max, sum of squares] of the relative stretch, from the last completed check
+        cl::Event mViolationReadEvent;
+        uint mSubStepsUsed;
+
+        std::vector<cl_uint> mCalmFrames; // per sleep cluster, from the last completed sleep check
+        cl::Event mCalmFramesReadEvent;
+        bool mHasCalmFrames; // false until a sleep check has been enqueued
+        std::vector<bool> mIsClusterAsleep;
+        bool mIsAnyClusterAsleep;
+        ClothSimParams mSleepParams; // parameters of the last frame, a change wakes up every cluster
+
+        std::unique_ptr<pbd::Grid> mGridCL; // of the current frame, see #updateGrid
+        uint mBinCapacity; // number of bins that the bin buffers fit
+        std::unique_ptr<cl::Buffer> mBinCountCL; // mBinCapacity-sized uint buffer, containing particle count per bin
         std::unique_ptr<cl::Buffer> mBinStartIDCL;
+        std::unique_ptr<util::PrefixScan> mBinStartIDScan; // scans mBinCountCL into mBinStartIDCL
+        std::unique_ptr<util::RadixSort> mParticleSort; // sorts the vertices of mArena by bin, see useRadixSort
+
+        /// Collision kernels, see kernels/counting_sort.cl ///
+        std::unique_ptr<cl::Program> mCountingSortProgram;
+        std::unique_ptr<cl::Kernel> mInsertParticles;
+        std::unique_ptr<cl::Kernel> mSortParticles;
+        std::unique_ptr<cl::Kernel> mCollideParticles;
+
+        /// Static collider kernel, see kernels/sdf_collision.cl ///
+        std::unique_ptr<cl::Program> mSdfCollisionProgram;
+        std::unique_ptr<cl::Kernel> mCollideSdfs;
+
+        enum CollisionStage {
+            COLLISION_BIN,      // clear the bin counts and insert the vertices
+            COLLISION_SCAN,     // prefix sum of the bin counts
+            COLLISION_SORT,     // write the vertices in bin order
+            COLLISION_RESOLVE,  // push apart the vertices that are too close
+            NUM_COLLISION_STAGES
+        };
+
+        std::vector<cl::Event> mCollisionEvents[NUM_COLLISION_STAGES]; // of the current frame
+        double mCollisionTimes[NUM_COLLISION_STAGES]; // device ms per frame, of the last finished frame
+
+        std::vector<cl_uint> mClothBounds; // 8 per cloth and for the scene, from the last completed bounds check
+        cl::Event mClothBoundsReadEvent;
+        bool mHasClothBounds; // false until a bounds check has been enqueued
+        std::vector<cl_uint> mClothPairs; // the contents of ClothArena::mClothPairsBufferCL
+        std::vector<std::pair<uint, uint>> mCollisionVertexRanges; // [offset, count] of the colliding vertices
+
+        std::unique_ptr<pbd::TriangleBVH> mTriangleBVH; // over the triangles of mArena, see ClothSimParams::useTriangleBVH
+        std::vector<cl::Event> mBVHBuildEvents, mBVHRefitEvents; // of the current frame
+        double mBVHBuildTime, mBVHRefitTime; // device ms per frame, of the last finished frame
 
         /// FPS
 
@@ -133,10 +338,16 @@ namespace pbd {
         static const uint NUM_AVG_SIM_TIMES;
         double mTimeOfLastUpdate;
         uint mFramesSinceLastUpdate;
+        uint mNumKernelLaunches;
 
         nanogui::Label *mLabelFPS;
         nanogui::Label *mLabelFrameNumber;
         nanogui::Label *mLabelAverageFrameTime;
+        nanogui::Label *mLabelKernelLaunches;
+        nanogui::Label *mLabelSubStepFusion;
+        nanogui::Label *mLabelSubSteps;
+        nanogui::Label *mLabelCollisionTimes;
+        nanogui::Label *mLabelBVHTimes;
         nanogui::Label *mErrorLabel;
     };
 }
\ No newline at end of file
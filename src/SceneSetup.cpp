@@ -15,6 +15,10 @@ glm::vec3 arrayToVector(const json &j) {
     return vec;
 }
 
+glm::vec3 arrayToVectorOr(const json &j, const std::string &key, const glm::vec3 &defaultValue) {
+    return j.count(key) ? arrayToVector(j[key]) : defaultValue;
+}
+
 pbd::SceneSetup pbd::SceneSetup::LoadFromJsonString(const std::string &str) {
     json j = json::parse(str.c_str());
 
@@ -85,11 +89,33 @@ pbd::SceneSetup pbd::SceneSetup::LoadFromJsonString(const std::string &str) {
             mesh.orientation = arrayToVector(jmesh["orientation"]);
             mesh.scale = jmesh["scale"];
             mesh.flipNormals = jmesh["flipNormals"];
+            mesh.multigridLevels = jmesh.value("multigridLevels", 0u);
+            mesh.vertexOrder = jmesh.value("vertexOrder", std::string("none"));
+            mesh.sdfCellSize = jmesh.value("sdfCellSize", 0.0f);
+            mesh.sdfBandWidth = jmesh.value("sdfBandWidth", 0.1f);
 
             setup.meshes.push_back(mesh);
         }
         setup.meshes.shrink_to_fit();
     }
 
+    if (j.count("colliders")) {
+        json jcolliders = j["colliders"];
+        for (const auto &jcollider : jcolliders) {
+            ColliderConfig collider;
+
+            collider.type = jcollider["type"];
+            collider.position = arrayToVectorOr(jcollider, "position", glm::vec3(0.0f));
+            collider.normal = arrayToVectorOr(jcollider, "normal", glm::vec3(0.0f, 1.0f, 0.0f));
+            collider.end = arrayToVectorOr(jcollider, "end", collider.position);
+            collider.halfExtents = arrayToVectorOr(jcollider, "halfExtents", glm::vec3(0.5f));
+            collider.orientation = arrayToVectorOr(jcollider, "orientation", glm::vec3(0.0f));
+            collider.radius = jcollider.value("radius", 0.5f);
+
+            setup.colliders.push_back(collider);
+        }
+        setup.colliders.shrink_to_fit();
+    }
+
     return setup;
 }
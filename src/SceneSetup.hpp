@@ -46,6 +46,23 @@ namespace pbd {
         glm::vec3 orientation;
         float scale;
         bool flipNormals;
+        unsigned int multigridLevels; // number of coarse levels of a cloth's multigrid hierarchy, 0 = none
+        std::string vertexOrder; // how a cloth's vertices are renumbered at load time, see VertexOrdering::Parse
+        float sdfCellSize; // sample spacing of a static mesh's collision distance field, 0 = doesn't collide
+        float sdfBandWidth; // max distance from the surface that the distance field stores
+    };
+
+    /**
+     * An analytic collider of a setup, see ColliderType.
+     */
+    struct ColliderConfig {
+        std::string type; // "PLANE", "SPHERE", "CAPSULE" or "BOX"
+        glm::vec3 position; // a point on a plane, sphere center, first capsule end or box center
+        glm::vec3 normal; // of a plane, points out of the collider
+        glm::vec3 end; // second capsule end
+        glm::vec3 halfExtents; // of a box
+        glm::vec3 orientation; // Euler angles of a box
+        float radius; // of a sphere or capsule
     };
 
     struct SceneSetup {
@@ -61,5 +78,8 @@ namespace pbd {
 
         std::vector<ShaderConfig> shaders;
         std::vector<MeshConfig> meshes;
+
+        /// Analytic colliders, empty if the setup only has the default ground plane
+        std::vector<ColliderConfig> colliders;
     };
 }
\ No newline at end of file
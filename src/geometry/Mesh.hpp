@@ -111,9 +111,29 @@ namespace pbd {
         unsigned long mNumVertices, mNumEdges, mNumTriangles;
     };
 
+    /**
+     * Host (CPU) representation of a coarse level of a cloth's multigrid
+     * hierarchy, see MeshLoader::BuildMultigridLevels. Vertex IDs are
+     * local to the cloth.
+     */
+    struct MultigridLevel {
+        /// The vertices of the level, a subset of the vertices of the next finer level
+        std::vector<uint> vertices;
+
+        /// Distance constraints between the vertices of the level, the rest lengths are calculated on the device
+        std::vector<StretchConstraint> constraints;
+
+        /// Interpolation of every vertex of the next finer level that is not part of this level,
+        /// the parents are indices into #vertices
+        std::vector<ProlongationStencil> stencils;
+    };
+
     /**
      * Host (CPU) representation of a cloth mesh. Does
      * NOT match the memory layout in device memory.
+     *
+     * The simulation state of every cloth lives in the shared
+     * buffers of a ClothArena, a ClothMesh only owns its render data.
      */
     class ClothMesh : public Mesh {
     public:
@@ -129,36 +149,27 @@ namespace pbd {
                   std::vector<ClothEdgeData>        && clothEdgeData,
                   std::vector<ClothTriangleData>    && clothTriangleData);
 
-        virtual void uploadHostData() override;
-
         virtual void clearHostData() override;
 
-        virtual void generateBuffersCL(cl::Context &context) override;
-
-        virtual std::vector<cl::Memory> getMemoryCL() override;
-
         virtual void render(clgl::BaseShader &shader, const glm::mat4 &VP, const glm::mat4 &M) override;
 
+        /**
+         * Returns the number of edge color batches in this mesh.
+         */
+        unsigned long numEdgeColors();
+
+        /// Host data of the cloth, packed into the device buffers of a ClothArena
         std::vector<ClothVertexData>    mVertexClothData;
         std::vector<ClothEdgeData>      mEdgeClothData;
         std::vector<ClothTriangleData>  mTriangleClothData;
 
-        bwgl::VertexBuffer mVertexClothBuffer;
-        cl::BufferGL mVertexClothBufferCL;
-
-        bwgl::VertexBuffer mVertexVelocitiesBuffer;
-        cl::BufferGL mVertexVelocitiesBufferCL;
-
-        bwgl::VertexBuffer mVertexPredictedPositionsBuffer;
-        cl::BufferGL mVertexPredictedPositionsBufferCL;
-
-        bwgl::VertexBuffer mVertexPositionCorrectionsBuffer;
-        cl::BufferGL mVertexPositionCorrectionsBufferCL;
+        /// Edges are sorted by color, color c spans [mEdgeColorOffsets[c], mEdgeColorOffsets[c + 1])
+        std::vector<uint> mEdgeColorOffsets;
 
-        cl::Buffer mTriangleClothBufferCL;
-        cl::Buffer mEdgeClothBufferCL;
-        cl::Buffer mDistToLineBufferCL;
+        /// Coarse levels of the multigrid hierarchy, from finest to coarsest. Empty if the cloth has none
+        std::vector<MultigridLevel> mMultigridLevels;
 
-        cl::Buffer mVertexInBinPosCL;
+        /// If true and the cloth has a multigrid hierarchy, every substep is followed by a V-cycle over its levels
+        bool mUseMultigrid;
     };
 }
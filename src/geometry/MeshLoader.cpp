@@ -8,8 +8,12 @@
 
 #include <SOIL.h>
 
+#include <algorithm>
+#include <limits>
 #include <map>
+#include <queue>
 #include <set>
+#include <numeric>
 
 namespace pbd {
     namespace MeshLoader {
@@ -148,6 +152,324 @@ namespace pbd {
             return edgevector;
         }
 
+        /**
+         * Greedily colors the edges so that no two edges of the same color share any of the
+         * vertices their constraints move ([p1, p2], plus [p3, p4] for bending edges), and
+         * reorders the edges so that every color is a contiguous batch.
+         * @return The offset of each color batch into the edges, followed by the total number
+         *         of edges, so that color c spans [offsets[c], offsets[c + 1])
+         */
+        std::vector<uint> ColorEdges(std::vector<Edge> &edges, const uint numVertices) {
+            std::vector<std::vector<uint>> vertexColors(numVertices);
+            std::vector<uint> edgeColors(edges.size());
+            std::vector<bool> isColorTaken;
+            uint numColors = 0;
+
+            /// Give each edge the lowest color not yet used by any of its vertices
+            for (uint edgeID = 0; edgeID < edges.size(); ++edgeID) {
+                const Edge &edge = edges[edgeID];
+                const uint numConstraintVertices = (edge.triangles[1] == -1) ? 2 : 4;
+
+                isColorTaken.assign(numColors + 1, false);
+                for (uint i = 0; i < numConstraintVertices; ++i) {
+                    for (uint color : vertexColors[edge.vertices[i]]) {
+                        isColorTaken[color] = true;
+                    }
+                }
+
+                uint color = 0;
+                while (isColorTaken[color]) ++color;
+
+                edgeColors[edgeID] = color;
+                numColors = std::max(numColors, color + 1);
+                for (uint i = 0; i < numConstraintVertices; ++i) {
+                    vertexColors[edge.vertices[i]].push_back(color);
+                }
+            }
+
+            /// Counting sort of the edges by color
+            std::vector<uint> offsets(numColors + 1, 0);
+            for (uint color : edgeColors) {
+                ++offsets[color + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            std::vector<uint> nextIndex(offsets.begin(), offsets.end() - 1);
+            std::vector<Edge> sortedEdges(edges.size());
+            for (uint edgeID = 0; edgeID < edges.size(); ++edgeID) {
+                sortedEdges[nextIndex[edgeColors[edgeID]]++] = edges[edgeID];
+            }
+            edges = std::move(sortedEdges);
+
+            return offsets;
+        }
+
+        /**
+         * Builds a CSR adjacency list from every vertex to the constraint delta slots that move it.
+         * Edge e writes the deltas of its vertices [p1, p2, p3, p4] to the slots [4e, 4e + 1, 4e + 2, 4e + 3],
+         * where [p3, p4] are only used by bending edges. Vertex v gathers from the slots
+         * slots[offsets[v]] to slots[offsets[v + 1] - 1], in ascending order.
+         */
+        void CalcVertexConstraintSlots(const std::vector<Edge> &edges,
+                                       const uint numVertices,
+                                       std::vector<uint> &offsets,
+                                       std::vector<uint> &slots) {
+            offsets.assign(numVertices + 1, 0);
+
+            /// Count the slots of every vertex
+            for (const auto &edge : edges) {
+                const uint numConstraintVertices = (edge.triangles[1] == -1) ? 2 : 4;
+                for (uint i = 0; i < numConstraintVertices; ++i) {
+                    ++offsets[edge.vertices[i] + 1];
+                }
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            /// Fill in the slot indices
+            slots.resize(offsets.back());
+            std::vector<uint> nextIndex(offsets.begin(), offsets.end() - 1);
+            for (uint edgeID = 0; edgeID < edges.size(); ++edgeID) {
+                const Edge &edge = edges[edgeID];
+                const uint numConstraintVertices = (edge.triangles[1] == -1) ? 2 : 4;
+                for (uint i = 0; i < numConstraintVertices; ++i) {
+                    slots[nextIndex[edge.vertices[i]]++] = 4 * edgeID + i;
+                }
+            }
+        }
+
+        std::vector<MultigridLevel> BuildMultigridLevels(const std::vector<Vertex> &vertices,
+                                                         const std::vector<Edge> &edges,
+                                                         const uint maxLevels) {
+            const uint numVertices = static_cast<uint>(vertices.size());
+            std::vector<MultigridLevel> levels;
+
+            /// Adjacency of the finer level
+            std::vector<std::set<uint>> neighbours(numVertices);
+            for (const auto &edge : edges) {
+                neighbours[edge.vertices[0]].insert(edge.vertices[1]);
+                neighbours[edge.vertices[1]].insert(edge.vertices[0]);
+            }
+
+            std::vector<uint> fineVertices(numVertices);
+            std::iota(fineVertices.begin(), fineVertices.end(), 0);
+
+            // index of a vertex into the vertices of the coarse level, -1 if it isn't part of it
+            std::vector<int> slots(numVertices);
+
+            while (levels.size() < maxLevels) {
+                MultigridLevel level;
+
+                /// Greedily pick a maximal independent set of the finer level
+                std::fill(slots.begin(), slots.end(), -1);
+                for (uint v : fineVertices) {
+                    const bool isIndependent = std::none_of(neighbours[v].begin(), neighbours[v].end(),
+                                                            [&](uint n) { return slots[n] != -1; });
+                    if (!isIndependent) continue;
+
+                    slots[v] = static_cast<int>(level.vertices.size());
+                    level.vertices.push_back(v);
+                }
+
+                if (level.vertices.size() < 4 || level.vertices.size() == fineVertices.size()) break;
+
+                /// Interpolate every other vertex from its (up to 4) nearest coarse neighbours, by inverse
+                /// distance. The weights only depend on distance ratios, which survive the scene transform
+                std::vector<std::pair<float, uint>> parents;
+                for (uint v : fineVertices) {
+                    if (slots[v] != -1) continue;
+
+                    parents.clear();
+                    for (uint n : neighbours[v]) {
+                        if (slots[n] == -1) continue;
+                        const float distance = glm::distance(vertices[v].position, vertices[n].position);
+                        parents.push_back(std::make_pair(std::max(distance, 1e-6f), n));
+                    }
+                    std::sort(parents.begin(), parents.end());
+                    if (parents.size() > 4) parents.resize(4);
+
+                    float weightSum = 0.0f;
+                    for (const auto &parent : parents) weightSum += 1.0f / parent.first;
+
+                    ProlongationStencil stencil;
+                    stencil.vertexID = static_cast<int>(v);
+                    for (uint i = 0; i < 4; ++i) {
+                        if (i < parents.size()) {
+                            stencil.parents[i] = slots[parents[i].second];
+                            stencil.weights[i] = (1.0f / parents[i].first) / weightSum;
+                        } else {
+                            stencil.parents[i] = -1;
+                            stencil.weights[i] = 0.0f;
+                        }
+                    }
+                    level.stencils.push_back(stencil);
+                }
+
+                /// Connect coarse vertices that share a neighbour (a - v - b),
+                /// or whose neighbours are adjacent (a - v - n - b)
+                std::vector<std::set<uint>> coarseNeighbours(numVertices);
+                auto connect = [&](uint a, uint b) {
+                    if (a == b) return;
+                    coarseNeighbours[a].insert(b);
+                    coarseNeighbours[b].insert(a);
+                };
+
+                for (uint v : fineVertices) {
+                    if (slots[v] != -1) continue;
+
+                    for (uint a : neighbours[v]) {
+                        if (slots[a] == -1) continue;
+
+                        for (uint n : neighbours[v]) {
+                            if (slots[n] != -1) {
+                                connect(a, n);
+                                continue;
+                            }
+                            for (uint b : neighbours[n]) {
+                                if (slots[b] != -1) connect(a, b);
+                            }
+                        }
+                    }
+                }
+
+                for (uint a : level.vertices) {
+                    for (uint b : coarseNeighbours[a]) {
+                        if (b < a) continue;
+
+                        StretchConstraint constraint;
+                        constraint.vertices[0] = static_cast<int>(a);
+                        constraint.vertices[1] = static_cast<int>(b);
+                        constraint.restLength = 0.0f;
+                        level.constraints.push_back(constraint);
+                    }
+                }
+
+                neighbours = std::move(coarseNeighbours);
+                fineVertices = level.vertices;
+                levels.push_back(std::move(level));
+            }
+
+            return levels;
+        }
+
+        void BuildConstraintPartitions(const std::vector<StretchConstraint> &stretchConstraints,
+                                       const std::vector<BendConstraint> &bendConstraints,
+                                       const uint numVertices,
+                                       const uint maxOwnedVertices,
+                                       std::vector<ConstraintPartition> &partitions,
+                                       std::vector<uint> &partitionVertices,
+                                       std::vector<PartitionConstraint> &partitionStretchConstraints,
+                                       std::vector<PartitionConstraint> &partitionBendConstraints) {
+            partitions.clear();
+            partitionVertices.clear();
+            partitionStretchConstraints.clear();
+            partitionBendConstraints.clear();
+            if (numVertices == 0) return;
+
+            std::vector<std::vector<uint>> neighbours(numVertices);
+            for (const auto &stretch : stretchConstraints) {
+                neighbours[stretch.vertices[0]].push_back(static_cast<uint>(stretch.vertices[1]));
+                neighbours[stretch.vertices[1]].push_back(static_cast<uint>(stretch.vertices[0]));
+            }
+
+            /// Grow each partition breadth-first from the lowest unassigned vertex until it is full, small
+            /// connected components (or separate cloths) share a partition until it is full
+            const uint unassigned = std::numeric_limits<uint>::max();
+            std::vector<uint> vertexPartitions(numVertices, unassigned);
+            uint partition = 0, partitionSize = 0;
+            for (uint seed = 0; seed < numVertices; ++seed) {
+                if (vertexPartitions[seed] != unassigned) continue;
+
+                if (partitionSize == maxOwnedVertices) {
+                    ++partition;
+                    partitionSize = 0;
+                }
+
+                std::queue<uint> frontier;
+                frontier.push(seed);
+                while (!frontier.empty() && partitionSize < maxOwnedVertices) {
+                    const uint v = frontier.front();
+                    frontier.pop();
+                    if (vertexPartitions[v] != unassigned) continue;
+
+                    vertexPartitions[v] = partition;
+                    ++partitionSize;
+                    for (uint n : neighbours[v]) {
+                        if (vertexPartitions[n] == unassigned) frontier.push(n);
+                    }
+                }
+            }
+            const uint numPartitions = partition + 1;
+
+            /// Every constraint belongs to the partition of its first vertex
+            std::vector<std::vector<uint>> stretchIDs(numPartitions), bendIDs(numPartitions);
+            for (uint i = 0; i < stretchConstraints.size(); ++i) {
+                stretchIDs[vertexPartitions[stretchConstraints[i].vertices[0]]].push_back(i);
+            }
+            for (uint i = 0; i < bendConstraints.size(); ++i) {
+                bendIDs[vertexPartitions[bendConstraints[i].vertices[0]]].push_back(i);
+            }
+
+            /// Collect the local vertices of every partition, and count the partitions that move each vertex
+            std::vector<std::vector<uint>> localVertices(numPartitions);
+            std::vector<uint> numMovingPartitions(numVertices, 0);
+            for (uint p = 0; p < numPartitions; ++p) {
+                auto &vertices = localVertices[p];
+                // the constraints are packed, so their vertices are copied one by one
+                for (uint i : stretchIDs[p]) {
+                    for (uint j = 0; j < 2; ++j) vertices.push_back(stretchConstraints[i].vertices[j]);
+                }
+                for (uint i : bendIDs[p]) {
+                    for (uint j = 0; j < 4; ++j) vertices.push_back(bendConstraints[i].vertices[j]);
+                }
+                std::sort(vertices.begin(), vertices.end());
+                vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+                for (uint v : vertices) ++numMovingPartitions[v];
+            }
+
+            /// Pack the partitions, with the constraints' vertices as indices into the local vertices
+            std::vector<uint> localIndices(numVertices, 0);
+            for (uint p = 0; p < numPartitions; ++p) {
+                auto &vertices = localVertices[p];
+                const auto interiorEnd = std::stable_partition(vertices.begin(), vertices.end(),
+                                                               [&](const uint v) {
+                                                                   return numMovingPartitions[v] == 1;
+                                                               });
+
+                ConstraintPartition data;
+                data.vertexOffset = static_cast<uint>(partitionVertices.size());
+                data.numVertices = static_cast<uint>(vertices.size());
+                data.numInteriorVertices = static_cast<uint>(interiorEnd - vertices.begin());
+                data.stretchOffset = static_cast<uint>(partitionStretchConstraints.size());
+                data.numStretchConstraints = static_cast<uint>(stretchIDs[p].size());
+                data.bendOffset = static_cast<uint>(partitionBendConstraints.size());
+                data.numBendConstraints = static_cast<uint>(bendIDs[p].size());
+                partitions.push_back(data);
+
+                for (uint i = 0; i < vertices.size(); ++i) {
+                    localIndices[vertices[i]] = i;
+                }
+                partitionVertices.insert(partitionVertices.end(), vertices.begin(), vertices.end());
+
+                for (uint i : stretchIDs[p]) {
+                    PartitionConstraint constraint;
+                    constraint.constraintID = i;
+                    constraint.localVertices[0] = localIndices[stretchConstraints[i].vertices[0]];
+                    constraint.localVertices[1] = localIndices[stretchConstraints[i].vertices[1]];
+                    constraint.localVertices[2] = constraint.localVertices[3] = 0;
+                    partitionStretchConstraints.push_back(constraint);
+                }
+                for (uint i : bendIDs[p]) {
+                    PartitionConstraint constraint;
+                    constraint.constraintID = i;
+                    for (uint j = 0; j < 4; ++j) {
+                        constraint.localVertices[j] = localIndices[bendConstraints[i].vertices[j]];
+                    }
+                    partitionBendConstraints.push_back(constraint);
+                }
+            }
+        }
+
         /**
          * http://stackoverflow.com/questions/8846501/neighbor-polygons-from-list-of-polygon-indices
          */
@@ -239,7 +561,7 @@ namespace pbd {
             return clothTriangleData;
         }
 
-        std::shared_ptr<Mesh> LoadMesh(const std::string &path) {
+        std::shared_ptr<Mesh> LoadMesh(const std::string &path, const VertexOrder vertexOrder) {
             Assimp::Importer importer;
 
             const aiScene *scene = importer.ReadFile(path.c_str(),
@@ -289,6 +611,9 @@ namespace pbd {
                 triangles[i] = triangle;
             }
 
+            /// renumber the vertices for locality, the edges below follow the new vertex order
+            VertexOrdering::Reorder(vertices, triangles, vertexOrder);
+
             auto edges = CalcEdges(triangles);
 
             auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(edges), std::move(triangles));
@@ -315,8 +640,12 @@ namespace pbd {
             return mesh;
         }
 
-        std::shared_ptr<ClothMesh> LoadClothMesh(const std::string &path) {
-            auto regularMesh = LoadMesh(path);
+        std::shared_ptr<ClothMesh> LoadClothMesh(const std::string &path, const uint numMultigridLevels,
+                                                 const VertexOrder vertexOrder) {
+            auto regularMesh = LoadMesh(path, vertexOrder);
+
+            auto edgeColorOffsets = ColorEdges(regularMesh->mEdges,
+                                               static_cast<uint>(regularMesh->numVertices()));
 
             auto clothTriangleData = CalcClothTriangleData(regularMesh->mTriangles);
 
@@ -324,7 +653,7 @@ namespace pbd {
             {
                 ClothVertexData data;
                 data.mass = 0.0f;
-                data.mass = 0.0f;
+                data.invmass = 0.0f;
                 for (unsigned int i = 0; i < regularMesh->numVertices(); ++i) {
                     data.vertexID = i;
                     clothVertexData.push_back(data);
@@ -342,12 +671,20 @@ namespace pbd {
                 }
             }
 
-            return std::make_shared<ClothMesh>(
+            auto cloth = std::make_shared<ClothMesh>(
                     std::move(*regularMesh),
                     std::move(clothVertexData),
                     std::move(clothEdgeData),
                     std::move(clothTriangleData)
             );
+            cloth->mEdgeColorOffsets = std::move(edgeColorOffsets);
+
+            if (numMultigridLevels > 0) {
+                cloth->mMultigridLevels = BuildMultigridLevels(cloth->mVertices, cloth->mEdges, numMultigridLevels);
+                cloth->mUseMultigrid = !cloth->mMultigridLevels.empty();
+            }
+
+            return cloth;
         }
     }
 }
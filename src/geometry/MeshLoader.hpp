@@ -3,11 +3,57 @@
 #include <memory>
 #include <vector>
 #include <geometry/Mesh.hpp>
+#include <geometry/VertexOrder.hpp>
 
 namespace pbd {
     namespace MeshLoader {
-        std::shared_ptr<Mesh> LoadMesh(const std::string &path);
+        /**
+         * Loads a mesh.
+         * @param vertexOrder How the vertices are renumbered, see VertexOrdering::Reorder
+         */
+        std::shared_ptr<Mesh> LoadMesh(const std::string &path, const VertexOrder vertexOrder = VertexOrder::NONE);
 
-        std::shared_ptr<ClothMesh> LoadClothMesh(const std::string &path);
+        /**
+         * Loads a cloth mesh.
+         * @param numMultigridLevels The max number of coarse levels of the cloth's multigrid hierarchy
+         * @param vertexOrder How the vertices are renumbered, see VertexOrdering::Reorder
+         */
+        std::shared_ptr<ClothMesh> LoadClothMesh(const std::string &path, const uint numMultigridLevels = 0,
+                                                 const VertexOrder vertexOrder = VertexOrder::NONE);
+
+        /**
+         * Builds a CSR adjacency list from every vertex to the constraint delta slots
+         * [4e, 4e + 1, 4e + 2, 4e + 3] of the edges e whose constraints move it.
+         */
+        void CalcVertexConstraintSlots(const std::vector<Edge> &edges,
+                                       const uint numVertices,
+                                       std::vector<uint> &offsets,
+                                       std::vector<uint> &slots);
+
+        /**
+         * Builds up to maxLevels coarsened levels of a cloth from its edge topology. The vertices of a
+         * level are a maximal independent set of the next finer level, so every other vertex of the finer
+         * level has at least one neighbour in the level, which it is interpolated from. Vertices of a level
+         * are connected by a distance constraint if they are at most three edges apart on the finer level.
+         * Coarsening stops early once a level would have fewer than 4 vertices.
+         */
+        std::vector<MultigridLevel> BuildMultigridLevels(const std::vector<Vertex> &vertices,
+                                                         const std::vector<Edge> &edges,
+                                                         const uint maxLevels);
+
+        /**
+         * Splits the vertices into partitions of up to maxOwnedVertices vertices, grown breadth-first over
+         * the stretch constraints so that every partition is a compact patch. Every constraint belongs to
+         * the partition of its first vertex, and the local vertices of a partition are the vertices that its
+         * constraints move, ordered interior vertices first. See ConstraintPartition.
+         */
+        void BuildConstraintPartitions(const std::vector<StretchConstraint> &stretchConstraints,
+                                       const std::vector<BendConstraint> &bendConstraints,
+                                       const uint numVertices,
+                                       const uint maxOwnedVertices,
+                                       std::vector<ConstraintPartition> &partitions,
+                                       std::vector<uint> &partitionVertices,
+                                       std::vector<PartitionConstraint> &partitionStretchConstraints,
+                                       std::vector<PartitionConstraint> &partitionBendConstraints);
     };
 }
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "SignedDistanceField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+#include <util/paths.hpp>
+
+namespace pbd {
+    const uint SignedDistanceField::BRICK_SIZE;
+    const uint SignedDistanceField::BRICK_SAMPLES;
+    const uint SignedDistanceField::EMPTY_BRICK;
+
+    /// Bumped whenever the baking or the cache file layout changes, so that stale cache files are not used
+    static const uint CACHE_VERSION = 1;
+
+    /**
+     * Returns the point of the triangle [a, b, c] that is closest to p. C. Ericson, "Real-Time Collision
+     * Detection", section 5.1.5.
+     */
+    static glm::vec3 ClosestPointOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b,
+                                            const glm::vec3 &c) {
+        const glm::vec3 ab = b - a;
+        const glm::vec3 ac = c - a;
+        const glm::vec3 ap = p - a;
+
+        const float d1 = glm::dot(ab, ap);
+        const float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+        const glm::vec3 bp = p - b;
+        const float d3 = glm::dot(ab, bp);
+        const float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return b;
+
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+        const glm::vec3 cp = p - c;
+        const float d5 = glm::dot(ab, cp);
+        const float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return c;
+
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        const float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    /**
+     * 64-bit FNV-1a hash of size bytes, continued from hash.
+     */
+    static uint64_t HashBytes(const void *data, const size_t size, uint64_t hash) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    SignedDistanceField SignedDistanceField::Bake(const std::vector<glm::vec3> &positions,
+                                                  const std::vector<Triangle> &triangles,
+                                                  const float cellSize, const float bandWidth,
+                                                  const bool flipNormals) {
+        SignedDistanceField sdf;
+        sdf.cellSize = cellSize;
+        sdf.bandWidth = bandWidth;
+
+        /// the grid covers the mesh and its band, in whole bricks
+        glm::vec3 lower(std::numeric_limits<float>::max());
+        glm::vec3 upper(-std::numeric_limits<float>::max());
+        for (const glm::vec3 &position : positions) {
+            lower = glm::min(lower, position);
+            upper = glm::max(upper, position);
+        }
+        lower -= glm::vec3(bandWidth + cellSize);
+        upper += glm::vec3(bandWidth + cellSize);
+
+        const float brickExtent = cellSize * BRICK_SIZE;
+        sdf.origin = lower;
+        sdf.numBricks = glm::uvec3(glm::max(glm::ceil((upper - lower) / brickExtent), glm::vec3(1.0f)));
+        const glm::uvec3 numSamples = sdf.numBricks * BRICK_SIZE + glm::uvec3(1);
+
+        /// the signed distance of every sample within the band of a triangle to the nearest triangle. Where
+        /// two triangles are equally near (at a shared edge or vertex), the sign of the triangle whose normal
+        /// is most aligned with the direction to the sample is used
+        struct Sample {
+            float distance;
+            float signedDistance;
+            float alignment;
+        };
+        std::unordered_map<uint64_t, Sample> samples;
+        const float tieDistance = 1e-4f * cellSize;
+
+        for (const Triangle &triangle : triangles) {
+            const glm::vec3 a = positions[triangle.vertices[0]];
+            const glm::vec3 b = positions[triangle.vertices[1]];
+            const glm::vec3 c = positions[triangle.vertices[2]];
+            const glm::vec3 normal = glm::cross(b - a, c - a);
+            if (glm::length(normal) == 0.0f) continue;
+            const glm::vec3 unitNormal = glm::normalize(normal) * (flipNormals ? -1.0f : 1.0f);
+
+            const glm::vec3 begin = glm::ceil((glm::min(glm::min(a, b), c) - bandWidth - sdf.origin) / cellSize);
+            const glm::vec3 end = glm::floor((glm::max(glm::max(a, b), c) + bandWidth - sdf.origin) / cellSize);
+            const glm::uvec3 first(glm::max(begin, glm::vec3(0.0f)));
+            const glm::uvec3 last(glm::min(end, glm::vec3(numSamples - glm::uvec3(1))));
+
+            for (uint z = first.z; z <= last.z; ++z) {
+                for (uint y = first.y; y <= last.y; ++y) {
+                    for (uint x = first.x; x <= last.x; ++x) {
+                        const glm::vec3 p = sdf.origin + cellSize * glm::vec3(x, y, z);
+                        const glm::vec3 diff = p - ClosestPointOnTriangle(p, a, b, c);
+                        const float distance = glm::length(diff);
+                        if (distance > bandWidth) continue;
+
+                        const float normalDistance = glm::dot(diff, unitNormal);
+                        const float alignment = distance > 0.0f ? std::abs(normalDistance) / distance : 1.0f;
+                        const Sample sample = {distance, normalDistance < 0.0f ? -distance : distance, alignment};
+
+                        const uint64_t key = x + numSamples.x * (y + static_cast<uint64_t>(numSamples.y) * z);
+                        auto it = samples.find(key);
+                        if (it == samples.end()) {
+                            samples[key] = sample;
+                        } else if (distance < it->second.distance - tieDistance
+                                   || (distance <= it->second.distance + tieDistance
+                                       && alignment > it->second.alignment)) {
+                            it->second = sample;
+                        }
+                    }
+                }
+            }
+        }
+
+        /// a brick is stored if any of its samples is within the band, a sample on the face of a
+        /// brick belongs to the neighbouring brick as well
+        sdf.brickTable.assign(sdf.numBricks.x * sdf.numBricks.y * sdf.numBricks.z, EMPTY_BRICK);
+        for (const auto &entry : samples) {
+            const uint64_t key = entry.first;
+            const glm::uvec3 sample(static_cast<uint>(key % numSamples.x),
+                                    static_cast<uint>((key / numSamples.x) % numSamples.y),
+                                    static_cast<uint>(key / (static_cast<uint64_t>(numSamples.x) * numSamples.y)));
+
+            uint bricks[3][2];
+            uint numCandidates[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                const uint brick = sample[axis] / BRICK_SIZE;
+                numCandidates[axis] = 0;
+                if (brick < sdf.numBricks[axis]) bricks[axis][numCandidates[axis]++] = brick;
+                if (brick > 0 && sample[axis] % BRICK_SIZE == 0) bricks[axis][numCandidates[axis]++] = brick - 1;
+            }
+
+            for (uint k = 0; k < numCandidates[2]; ++k) {
+                for (uint j = 0; j < numCandidates[1]; ++j) {
+                    for (uint i = 0; i < numCandidates[0]; ++i) {
+                        const uint brick = bricks[0][i] + sdf.numBricks.x * (bricks[1][j]
+                                                                             + sdf.numBricks.y * bricks[2][k]);
+                        sdf.brickTable[brick] = 0;
+                    }
+                }
+            }
+        }
+
+        uint numStoredBricks = 0;
+        for (uint &brick : sdf.brickTable) {
+            if (brick != EMPTY_BRICK) brick = numStoredBricks++;
+        }
+
+        /// copy the samples of the stored bricks, the samples outside the band are clamped to it
+        const uint samplesPerBrick = BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES;
+        sdf.brickSamples.assign(numStoredBricks * samplesPerBrick, bandWidth);
+        for (uint bz = 0; bz < sdf.numBricks.z; ++bz) {
+            for (uint by = 0; by < sdf.numBricks.y; ++by) {
+                for (uint bx = 0; bx < sdf.numBricks.x; ++bx) {
+                    const uint brickID = sdf.brickTable[bx + sdf.numBricks.x * (by + sdf.numBricks.y * bz)];
+                    if (brickID == EMPTY_BRICK) continue;
+
+                    float *brickSamples = &sdf.brickSamples[brickID * samplesPerBrick];
+                    for (uint z = 0; z < BRICK_SAMPLES; ++z) {
+                        for (uint y = 0; y < BRICK_SAMPLES; ++y) {
+                            for (uint x = 0; x < BRICK_SAMPLES; ++x) {
+                                const uint64_t key = (bx * BRICK_SIZE + x) + numSamples.x *
+                                        ((by * BRICK_SIZE + y) + static_cast<uint64_t>(numSamples.y)
+                                                                 * (bz * BRICK_SIZE + z));
+                                auto it = samples.find(key);
+                                if (it != samples.end()) {
+                                    brickSamples[(z * BRICK_SAMPLES + y) * BRICK_SAMPLES + x] =
+                                            it->second.signedDistance;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return sdf;
+    }
+
+    SignedDistanceField SignedDistanceField::LoadOrBake(const std::vector<glm::vec3> &positions,
+                                                        const std::vector<Triangle> &triangles,
+                                                        const float cellSize, const float bandWidth,
+                                                        const bool flipNormals) {
+        /// the cache key covers everything that the baked field depends on
+        uint64_t hash = 14695981039346656037ull;
+        const uint header[3] = {CACHE_VERSION, BRICK_SIZE, flipNormals ? 1u : 0u};
+        const float sizes[2] = {cellSize, bandWidth};
+        hash = HashBytes(header, sizeof(header), hash);
+        hash = HashBytes(sizes, sizeof(sizes), hash);
+        hash = HashBytes(positions.data(), sizeof(glm::vec3) * positions.size(), hash);
+        hash = HashBytes(triangles.data(), sizeof(Triangle) * triangles.size(), hash);
+
+        std::stringstream ss;
+        ss << "sdf-" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+        const std::string filename = OUTPUTPATH(ss.str());
+
+        /// [origin, cellSize, bandWidth, numBricks, number of stored bricks], the brick table and the samples
+        SignedDistanceField sdf;
+        std::ifstream in(filename, std::ios::binary);
+        if (in) {
+            uint numStoredBricks = 0;
+            in.read(reinterpret_cast<char *>(&sdf.origin), sizeof(glm::vec3));
+            in.read(reinterpret_cast<char *>(&sdf.cellSize), sizeof(float));
+            in.read(reinterpret_cast<char *>(&sdf.bandWidth), sizeof(float));
+            in.read(reinterpret_cast<char *>(&sdf.numBricks), sizeof(glm::uvec3));
+            in.read(reinterpret_cast<char *>(&numStoredBricks), sizeof(uint));
+
+            if (in) {
+                sdf.brickTable.resize(sdf.numBricks.x * sdf.numBricks.y * sdf.numBricks.z);
+                sdf.brickSamples.resize(numStoredBricks * BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES);
+                in.read(reinterpret_cast<char *>(sdf.brickTable.data()), sizeof(uint) * sdf.brickTable.size());
+                in.read(reinterpret_cast<char *>(sdf.brickSamples.data()), sizeof(float) * sdf.brickSamples.size());
+            }
+
+            if (in) return sdf;
+            std::cerr << "Failed to read SDF cache " << filename << ", baking it instead" << std::endl;
+        }
+
+        sdf = Bake(positions, triangles, cellSize, bandWidth, flipNormals);
+
+        // the cache is optional, a missing output folder only means that the field is baked again next time
+        std::ofstream out(filename, std::ios::binary);
+        if (out) {
+            const uint numStoredBricks = static_cast<uint>(sdf.brickSamples.size()
+                                                           / (BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES));
+            out.write(reinterpret_cast<const char *>(&sdf.origin), sizeof(glm::vec3));
+            out.write(reinterpret_cast<const char *>(&sdf.cellSize), sizeof(float));
+            out.write(reinterpret_cast<const char *>(&sdf.bandWidth), sizeof(float));
+            out.write(reinterpret_cast<const char *>(&sdf.numBricks), sizeof(glm::uvec3));
+            out.write(reinterpret_cast<const char *>(&numStoredBricks), sizeof(uint));
+            out.write(reinterpret_cast<const char *>(sdf.brickTable.data()), sizeof(uint) * sdf.brickTable.size());
+            out.write(reinterpret_cast<const char *>(sdf.brickSamples.data()),
+                      sizeof(float) * sdf.brickSamples.size());
+        }
+
+        return sdf;
+    }
+
+    unsigned long SignedDistanceField::numSamples() const {
+        return brickSamples.size();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <geometry/geometry.hpp>
+
+namespace pbd {
+    /**
+     * Host (CPU) representation of a narrow-band signed distance field of a static triangle mesh, sampled on a
+     * regular grid in world space. The grid is split into bricks of BRICK_SIZE^3 cells, and only the bricks
+     * that have a sample within bandWidth of the surface are stored, with BRICK_SAMPLES^3 samples each (the
+     * samples on a brick's upper faces duplicate the lower faces of its neighbours), so that a trilinear lookup
+     * never crosses a brick. Samples farther than bandWidth from the surface are clamped to +bandWidth.
+     *
+     * The sign is taken from the winding of the nearest triangle, distances are negative behind the front
+     * faces. Open meshes like planes work as long as cloths only approach them from the front.
+     */
+    struct SignedDistanceField {
+        static const uint BRICK_SIZE = 8;
+        static const uint BRICK_SAMPLES = BRICK_SIZE + 1;
+        static const uint EMPTY_BRICK = 0xFFFFFFFFu;
+
+        /**
+         * Bakes the signed distance field of the triangles over positions (in world space).
+         * @param cellSize The distance between two samples (m)
+         * @param bandWidth The max distance from the surface that is stored (m)
+         * @param flipNormals If true, distances are negative in front of the faces instead
+         */
+        static SignedDistanceField Bake(const std::vector<glm::vec3> &positions,
+                                        const std::vector<Triangle> &triangles,
+                                        const float cellSize, const float bandWidth, const bool flipNormals);
+
+        /**
+         * Loads the baked field of the same input as #Bake from the cache in the output folder,
+         * or bakes and caches it if it isn't cached yet. The cache is keyed by a hash of the input.
+         */
+        static SignedDistanceField LoadOrBake(const std::vector<glm::vec3> &positions,
+                                              const std::vector<Triangle> &triangles,
+                                              const float cellSize, const float bandWidth, const bool flipNormals);
+
+        /**
+         * Returns the number of samples of the stored bricks.
+         */
+        unsigned long numSamples() const;
+
+        /// World position of the first sample, and the distance between two samples
+        glm::vec3 origin;
+        float cellSize;
+        float bandWidth;
+
+        glm::uvec3 numBricks;
+
+        /// Index of every brick into the stored bricks, x-major, EMPTY_BRICK if it isn't stored
+        std::vector<uint> brickTable;
+
+        /// BRICK_SAMPLES^3 samples per stored brick, x-major
+        std::vector<float> brickSamples;
+    };
+}
@@ -0,0 +1,303 @@
+#include "VertexOrder.hpp"
+#include <util/math_util.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <utility>
+
+namespace pbd {
+    namespace VertexOrdering {
+        typedef unsigned int uint;
+
+        /// Number of bits per axis of the space-filling curve keys
+        static const uint CURVE_BITS = 10;
+
+        /**
+         * Quantizes the vertex positions to a (2^CURVE_BITS)^3 grid over their bounding box.
+         */
+        static std::vector<glm::uvec3> QuantizePositions(const std::vector<Vertex> &vertices) {
+            glm::vec3 lower(std::numeric_limits<float>::max());
+            glm::vec3 upper(-std::numeric_limits<float>::max());
+            for (const auto &vertex : vertices) {
+                lower = glm::min(lower, vertex.position);
+                upper = glm::max(upper, vertex.position);
+            }
+
+            // the same scale on every axis, so that flat cloths keep their aspect ratio
+            const glm::vec3 extent = upper - lower;
+            const float maxExtent = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+            const float scale = ((1u << CURVE_BITS) - 1) / maxExtent;
+
+            std::vector<glm::uvec3> cells;
+            cells.reserve(vertices.size());
+            for (const auto &vertex : vertices) {
+                cells.push_back(glm::uvec3((vertex.position - lower) * scale));
+            }
+            return cells;
+        }
+
+        /**
+         * Interleaves the bits of the three coordinates, most significant bit first.
+         */
+        static unsigned long long InterleaveBits(const glm::uvec3 &cell) {
+            unsigned long long key = 0;
+            for (int bit = CURVE_BITS - 1; bit >= 0; --bit) {
+                for (uint axis = 0; axis < 3; ++axis) {
+                    key = (key << 1) | ((cell[axis] >> bit) & 1u);
+                }
+            }
+            return key;
+        }
+
+        /**
+         * Converts a cell to the "transposed" Hilbert index, whose interleaved bits are the index along the
+         * Hilbert curve. J. Skilling, "Programming the Hilbert curve", AIP Conference Proceedings 707, 2004.
+         */
+        static glm::uvec3 AxesToTransposedHilbert(glm::uvec3 X) {
+            const uint M = 1u << (CURVE_BITS - 1);
+
+            /// inverse undo
+            for (uint Q = M; Q > 1; Q >>= 1) {
+                const uint P = Q - 1;
+                for (uint i = 0; i < 3; ++i) {
+                    if (X[i] & Q) {
+                        X[0] ^= P;
+                    } else {
+                        const uint t = (X[0] ^ X[i]) & P;
+                        X[0] ^= t;
+                        X[i] ^= t;
+                    }
+                }
+            }
+
+            /// Gray encode
+            for (uint i = 1; i < 3; ++i) X[i] ^= X[i - 1];
+            uint t = 0;
+            for (uint Q = M; Q > 1; Q >>= 1) {
+                if (X[2] & Q) t ^= Q - 1;
+            }
+            for (uint i = 0; i < 3; ++i) X[i] ^= t;
+
+            return X;
+        }
+
+        /**
+         * Returns the order of the vertices sorted by their keys, ties are kept in file order.
+         */
+        static std::vector<uint> SortByKeys(const std::vector<unsigned long long> &keys) {
+            std::vector<uint> order(keys.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](const uint a, const uint b) {
+                return keys[a] < keys[b];
+            });
+            return order;
+        }
+
+        /**
+         * Returns the vertices of the last level of a breadth-first search from start, and the number of levels.
+         */
+        static std::pair<std::vector<uint>, uint> FindLastLevel(const std::vector<std::vector<uint>> &neighbours,
+                                                                const uint start) {
+            std::vector<int> depths(neighbours.size(), -1);
+            std::vector<uint> level = {start}, lastLevel;
+            depths[start] = 0;
+
+            uint numLevels = 0;
+            while (!level.empty()) {
+                lastLevel = level;
+                ++numLevels;
+
+                std::vector<uint> nextLevel;
+                for (uint v : level) {
+                    for (uint n : neighbours[v]) {
+                        if (depths[n] != -1) continue;
+                        depths[n] = numLevels;
+                        nextLevel.push_back(n);
+                    }
+                }
+                level = std::move(nextLevel);
+            }
+
+            return std::make_pair(lastLevel, numLevels);
+        }
+
+        /**
+         * Reverse Cuthill-McKee: a breadth-first search from a pseudo-peripheral vertex of every connected
+         * component, that visits the neighbours of a vertex by increasing degree, in reverse.
+         */
+        static std::vector<uint> CalcReverseCuthillMcKee(const uint numVertices,
+                                                         const std::vector<Triangle> &triangles) {
+            std::vector<std::vector<uint>> neighbours(numVertices);
+            {
+                std::vector<std::set<uint>> neighbourSets(numVertices);
+                for (const auto &triangle : triangles) {
+                    for (uint i = 0; i < 3; ++i) {
+                        neighbourSets[triangle.vertices[i]].insert(triangle.vertices[(i + 1) % 3]);
+                        neighbourSets[triangle.vertices[(i + 1) % 3]].insert(triangle.vertices[i]);
+                    }
+                }
+                for (uint v = 0; v < numVertices; ++v) {
+                    neighbours[v].assign(neighbourSets[v].begin(), neighbourSets[v].end());
+                }
+            }
+
+            const auto byDegree = [&](const uint a, const uint b) {
+                return neighbours[a].size() < neighbours[b].size()
+                       || (neighbours[a].size() == neighbours[b].size() && a < b);
+            };
+            for (auto &vertexNeighbours : neighbours) {
+                std::sort(vertexNeighbours.begin(), vertexNeighbours.end(), byDegree);
+            }
+
+            std::vector<uint> order;
+            order.reserve(numVertices);
+            std::vector<bool> isVisited(numVertices, false);
+
+            std::vector<uint> verticesByDegree(numVertices);
+            std::iota(verticesByDegree.begin(), verticesByDegree.end(), 0);
+            std::sort(verticesByDegree.begin(), verticesByDegree.end(), byDegree);
+
+            for (uint seed : verticesByDegree) {
+                if (isVisited[seed]) continue;
+
+                /// find a pseudo-peripheral vertex, by moving to the lowest degree vertex of the last
+                /// breadth-first level for as long as that increases the number of levels
+                uint start = seed;
+                auto lastLevel = FindLastLevel(neighbours, start);
+                for (uint i = 0; i < 8; ++i) {
+                    const uint candidate = *std::min_element(lastLevel.first.begin(), lastLevel.first.end(), byDegree);
+                    const auto candidateLastLevel = FindLastLevel(neighbours, candidate);
+                    if (candidateLastLevel.second <= lastLevel.second) break;
+
+                    start = candidate;
+                    lastLevel = candidateLastLevel;
+                }
+
+                std::queue<uint> frontier;
+                frontier.push(start);
+                isVisited[start] = true;
+                while (!frontier.empty()) {
+                    const uint v = frontier.front();
+                    frontier.pop();
+                    order.push_back(v);
+
+                    for (uint n : neighbours[v]) {
+                        if (isVisited[n]) continue;
+                        isVisited[n] = true;
+                        frontier.push(n);
+                    }
+                }
+            }
+
+            std::reverse(order.begin(), order.end());
+            return order;
+        }
+
+        VertexOrder Parse(const std::string &name) {
+            if (name == "morton") return VertexOrder::MORTON;
+            if (name == "hilbert") return VertexOrder::HILBERT;
+            if (name == "rcm") return VertexOrder::REVERSE_CUTHILL_MCKEE;
+            return VertexOrder::NONE;
+        }
+
+        std::vector<uint> CalcNewIndices(const std::vector<Vertex> &vertices,
+                                         const std::vector<Triangle> &triangles,
+                                         const VertexOrder order) {
+            const uint numVertices = static_cast<uint>(vertices.size());
+
+            /// the vertices in their new order
+            std::vector<uint> orderedVertices;
+            switch (order) {
+                case VertexOrder::MORTON:
+                case VertexOrder::HILBERT: {
+                    const auto cells = QuantizePositions(vertices);
+                    std::vector<unsigned long long> keys;
+                    keys.reserve(numVertices);
+                    for (const auto &cell : cells) {
+                        keys.push_back(InterleaveBits(order == VertexOrder::HILBERT ? AxesToTransposedHilbert(cell)
+                                                                                    : cell));
+                    }
+                    orderedVertices = SortByKeys(keys);
+                    break;
+                }
+
+                case VertexOrder::REVERSE_CUTHILL_MCKEE:
+                    orderedVertices = CalcReverseCuthillMcKee(numVertices, triangles);
+                    break;
+
+                case VertexOrder::NONE:
+                default:
+                    orderedVertices.resize(numVertices);
+                    std::iota(orderedVertices.begin(), orderedVertices.end(), 0);
+                    break;
+            }
+
+            std::vector<uint> newIndices(numVertices);
+            for (uint i = 0; i < numVertices; ++i) {
+                newIndices[orderedVertices[i]] = i;
+            }
+            return newIndices;
+        }
+
+        void Reorder(std::vector<Vertex> &vertices,
+                     std::vector<Triangle> &triangles,
+                     const VertexOrder order) {
+            if (order == VertexOrder::NONE) return;
+
+            const auto newIndices = CalcNewIndices(vertices, triangles, order);
+
+            std::vector<Vertex> orderedVertices(vertices.size());
+            for (uint i = 0; i < vertices.size(); ++i) {
+                orderedVertices[newIndices[i]] = vertices[i];
+            }
+            vertices = std::move(orderedVertices);
+
+            for (auto &triangle : triangles) {
+                for (uint i = 0; i < 3; ++i) {
+                    triangle.vertices[i] = newIndices[triangle.vertices[i]];
+                }
+            }
+            std::stable_sort(triangles.begin(), triangles.end(), [](const Triangle &a, const Triangle &b) {
+                return util::min(a.vertices.x, a.vertices.y, a.vertices.z)
+                       < util::min(b.vertices.x, b.vertices.y, b.vertices.z);
+            });
+        }
+
+        float CalcEdgeCacheLines(const std::vector<Triangle> &triangles) {
+            /// the edges in the order of MeshLoader::CalcEdges, by lowest and then highest vertex
+            std::vector<std::pair<uint, uint>> edges;
+            edges.reserve(3 * triangles.size());
+            for (const auto &triangle : triangles) {
+                for (uint i = 0; i < 3; ++i) {
+                    const uint a = triangle.vertices[i];
+                    const uint b = triangle.vertices[(i + 1) % 3];
+                    edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+            if (edges.empty()) return 0.0f;
+
+            /// 4 float3 vertices per 64-byte cache line
+            const uint batchSize = 32, verticesPerLine = 4;
+            uint numLines = 0, numBatches = 0;
+            std::vector<uint> lines;
+            for (uint begin = 0; begin < edges.size(); begin += batchSize) {
+                lines.clear();
+                const uint end = std::min<uint>(begin + batchSize, static_cast<uint>(edges.size()));
+                for (uint i = begin; i < end; ++i) {
+                    lines.push_back(edges[i].first / verticesPerLine);
+                    lines.push_back(edges[i].second / verticesPerLine);
+                }
+                std::sort(lines.begin(), lines.end());
+                numLines += static_cast<uint>(std::unique(lines.begin(), lines.end()) - lines.begin());
+                ++numBatches;
+            }
+
+            return static_cast<float>(numLines) / numBatches;
+        }
+    }
+}
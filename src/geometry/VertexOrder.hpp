@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <geometry/geometry.hpp>
+
+namespace pbd {
+    /**
+     * How the vertices of a mesh are renumbered at load time, so that vertices that are close on
+     * the mesh are close in the vertex buffers and neighbouring work-items touch the same cache lines.
+     */
+    enum class VertexOrder {
+        // Keep the order of the model file
+        NONE,
+
+        // Sort the vertices along a Z-order (Morton) curve through their bounding box
+        MORTON,
+
+        // Sort the vertices along a Hilbert curve through their bounding box, which unlike the
+        // Morton curve never jumps between distant cells
+        HILBERT,
+
+        // Reverse Cuthill-McKee order of the mesh graph, which minimizes the index distance between
+        // connected vertices and works for any mesh shape
+        REVERSE_CUTHILL_MCKEE
+    };
+
+    namespace VertexOrdering {
+        /**
+         * Parses "none", "morton", "hilbert" or "rcm", anything else is VertexOrder::NONE.
+         */
+        VertexOrder Parse(const std::string &name);
+
+        /**
+         * Calculates the new index of every vertex in the given order.
+         */
+        std::vector<unsigned int> CalcNewIndices(const std::vector<Vertex> &vertices,
+                                                 const std::vector<Triangle> &triangles,
+                                                 const VertexOrder order);
+
+        /**
+         * Renumbers the vertices in the given order, remaps the triangles to the new indices and sorts
+         * them by their lowest vertex. Edges that are calculated afterwards (see MeshLoader::CalcEdges)
+         * are sorted by their lowest vertex as well.
+         */
+        void Reorder(std::vector<Vertex> &vertices,
+                     std::vector<Triangle> &triangles,
+                     const VertexOrder order);
+
+        /**
+         * Returns the mean number of distinct 64-byte cache lines of a float3 vertex buffer that a batch
+         * of 32 consecutive edges touches, with the edges in the order of MeshLoader::CalcEdges. A proxy
+         * for the cache misses of the per-edge projection kernels, lower is better and 64 is the worst case.
+         */
+        float CalcEdgeCacheLines(const std::vector<Triangle> &triangles);
+    }
+}
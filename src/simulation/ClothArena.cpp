@@ -0,0 +1,520 @@
+#include "ClothArena.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <glm/glm.hpp>
+
+#include <geometry/MeshLoader.hpp>
+#include <util/OCL_CALL.hpp>
+
+namespace pbd {
+    ClothArena::ClothArena(cl::Context &context, const std::vector<std::shared_ptr<ClothMesh>> &cloths)
+            : mNumVertices(0), mNumEdges(0), mNumTriangles(0), mNumEdgeColors(0), mNumBendConstraints(0),
+              mNumMultigridLevels(0), mMeanRestEdgeLength(0.0f), mHasUnconstrainedVertices(false),
+              mNumActiveVertices(0), mNumActiveStretchConstraints(0), mNumActiveBendConstraints(0), mNumPartitions(0),
+              mMaxPartitionVertices(0) {
+        const uint numCloths = static_cast<uint>(cloths.size());
+
+        /// Lay out the cloths one after another
+        std::vector<uint> triangleOffsets;
+        for (const auto &cloth : cloths) {
+            ClothRange range;
+            range.vertexOffset = static_cast<uint>(mNumVertices);
+            range.numVertices = static_cast<uint>(cloth->numVertices());
+            range.numEdges = static_cast<uint>(cloth->numEdges());
+            mClothRanges.push_back(range);
+            triangleOffsets.push_back(static_cast<uint>(mNumTriangles));
+
+            mNumVertices += cloth->numVertices();
+            mNumEdges += cloth->numEdges();
+            mNumTriangles += cloth->numTriangles();
+            mNumEdgeColors = std::max(mNumEdgeColors, cloth->numEdgeColors());
+            mNumMultigridLevels = std::max<unsigned long>(mNumMultigridLevels, cloth->mMultigridLevels.size());
+        }
+
+        /// Pack the vertices
+        std::vector<glm::vec4> positions;
+        std::vector<ClothVertexData> clothVertices;
+        positions.reserve(mNumVertices);
+        clothVertices.reserve(mNumVertices);
+        for (uint k = 0; k < numCloths; ++k) {
+            const auto &cloth = cloths[k];
+            for (uint i = 0; i < cloth->numVertices(); ++i) {
+                positions.push_back(glm::vec4(cloth->mVertices[i].position, 0.0f));
+
+                ClothVertexData data = cloth->mVertexClothData[i];
+                data.vertexID += mClothRanges[k].vertexOffset;
+                clothVertices.push_back(data);
+            }
+        }
+
+        /// Pack the triangles
+        std::vector<Triangle> triangles;
+        std::vector<ClothTriangleData> clothTriangles;
+        triangles.reserve(mNumTriangles);
+        clothTriangles.reserve(mNumTriangles);
+        for (uint k = 0; k < numCloths; ++k) {
+            const auto &cloth = cloths[k];
+            for (uint i = 0; i < cloth->numTriangles(); ++i) {
+                Triangle triangle = cloth->mTriangles[i];
+                triangle.vertices += glm::uvec3(mClothRanges[k].vertexOffset);
+                triangles.push_back(triangle);
+
+                ClothTriangleData data = cloth->mTriangleClothData[i];
+                data.triangleID += triangleOffsets[k];
+                for (uint j = 0; j < 3; ++j) {
+                    if (data.neighbourIDs[j] != -1) data.neighbourIDs[j] += triangleOffsets[k];
+                }
+                clothTriangles.push_back(data);
+            }
+        }
+
+        /// Pack the edges color-major, so that every color of all cloths is a contiguous batch
+        std::vector<Edge> edges;
+        std::vector<ClothEdgeData> clothEdges;
+        edges.reserve(mNumEdges);
+        clothEdges.reserve(mNumEdges);
+        for (uint color = 0; color < mNumEdgeColors; ++color) {
+            for (uint k = 0; k < numCloths; ++k) {
+                mEdgeBatchOffsets.push_back(static_cast<uint>(edges.size()));
+
+                const auto &cloth = cloths[k];
+                if (color >= cloth->numEdgeColors()) continue;
+
+                for (uint i = cloth->mEdgeColorOffsets[color]; i < cloth->mEdgeColorOffsets[color + 1]; ++i) {
+                    Edge edge = cloth->mEdges[i];
+                    for (uint j = 0; j < 2; ++j) {
+                        if (edge.triangles[j] != -1) edge.triangles[j] += triangleOffsets[k];
+                    }
+                    for (uint j = 0; j < 4; ++j) {
+                        if (edge.vertices[j] != -1) edge.vertices[j] += mClothRanges[k].vertexOffset;
+                    }
+
+                    ClothEdgeData data = cloth->mEdgeClothData[i];
+                    data.edgeID = static_cast<uint>(edges.size());
+
+                    edges.push_back(edge);
+                    clothEdges.push_back(data);
+                }
+            }
+            mEdgeBatchOffsets.push_back(static_cast<uint>(edges.size()));
+        }
+
+        /// Split the edges into compacted stretch and bend constraint streams,
+        /// the rest lengths and angles are calculated by setup kernels
+        std::vector<StretchConstraint> stretchConstraints;
+        std::vector<BendConstraint> bendConstraints;
+        stretchConstraints.reserve(mNumEdges);
+        for (const auto &edge : edges) {
+            StretchConstraint stretch;
+            stretch.vertices[0] = edge.vertices[0];
+            stretch.vertices[1] = edge.vertices[1];
+            stretch.restLength = 0.0f;
+            stretchConstraints.push_back(stretch);
+            mMeanRestEdgeLength += glm::distance(glm::vec3(positions[edge.vertices[0]]),
+                                                 glm::vec3(positions[edge.vertices[1]]));
+
+            if (edge.triangles[1] == -1) continue;
+
+            BendConstraint bend;
+            for (uint i = 0; i < 4; ++i) bend.vertices[i] = edge.vertices[i];
+            bend.restAngle = 0.0f;
+            bendConstraints.push_back(bend);
+        }
+        mNumBendConstraints = bendConstraints.size();
+        if (!edges.empty()) mMeanRestEdgeLength /= edges.size();
+
+        /// Pack the multigrid levels level-major, so that every level of a cloth is contiguous
+        std::vector<uint> levelVertices;
+        std::vector<StretchConstraint> levelConstraints;
+        std::vector<ProlongationStencil> levelStencils;
+        for (uint level = 0; level < mNumMultigridLevels; ++level) {
+            for (uint k = 0; k < numCloths; ++k) {
+                const uint levelOffset = static_cast<uint>(levelVertices.size());
+                mLevelVertexOffsets.push_back(levelOffset);
+                mLevelConstraintOffsets.push_back(static_cast<uint>(levelConstraints.size()));
+                mLevelStencilOffsets.push_back(static_cast<uint>(levelStencils.size()));
+
+                const auto &levels = cloths[k]->mMultigridLevels;
+                if (level >= levels.size()) continue;
+
+                const uint vertexOffset = mClothRanges[k].vertexOffset;
+                for (uint v : levels[level].vertices) {
+                    levelVertices.push_back(v + vertexOffset);
+                }
+                for (StretchConstraint constraint : levels[level].constraints) {
+                    constraint.vertices[0] += vertexOffset;
+                    constraint.vertices[1] += vertexOffset;
+                    levelConstraints.push_back(constraint);
+                }
+                for (ProlongationStencil stencil : levels[level].stencils) {
+                    stencil.vertexID += vertexOffset;
+                    for (uint i = 0; i < 4; ++i) {
+                        if (stencil.parents[i] != -1) stencil.parents[i] += levelOffset;
+                    }
+                    levelStencils.push_back(stencil);
+                }
+            }
+            mLevelVertexOffsets.push_back(static_cast<uint>(levelVertices.size()));
+            mLevelConstraintOffsets.push_back(static_cast<uint>(levelConstraints.size()));
+            mLevelStencilOffsets.push_back(static_cast<uint>(levelStencils.size()));
+        }
+
+        /// Split every cloth into sleep clusters of consecutive vertices
+        for (const auto &range : mClothRanges) {
+            mClothSleepClusterOffsets.push_back(static_cast<uint>(mSleepClusterOffsets.size()));
+            for (uint v = 0; v < range.numVertices; v += SLEEP_CLUSTER_SIZE) {
+                mSleepClusterOffsets.push_back(range.vertexOffset + v);
+            }
+        }
+        mClothSleepClusterOffsets.push_back(static_cast<uint>(mSleepClusterOffsets.size()));
+        mSleepClusterOffsets.push_back(static_cast<uint>(mNumVertices));
+
+        mVertexSleepClusters.resize(mNumVertices);
+        for (uint c = 0; c < numSleepClusters(); ++c) {
+            std::fill(mVertexSleepClusters.begin() + mSleepClusterOffsets[c],
+                      mVertexSleepClusters.begin() + mSleepClusterOffsets[c + 1], c);
+        }
+
+        /// Clusters are neighbours if a stretch constraint connects them
+        {
+            std::vector<std::set<uint>> neighbours(numSleepClusters());
+            for (const auto &stretch : stretchConstraints) {
+                const uint c1 = mVertexSleepClusters[stretch.vertices[0]];
+                const uint c2 = mVertexSleepClusters[stretch.vertices[1]];
+                if (c1 == c2) continue;
+                neighbours[c1].insert(c2);
+                neighbours[c2].insert(c1);
+            }
+
+            mSleepClusterNeighbourOffsets.push_back(0);
+            for (const auto &clusterNeighbours : neighbours) {
+                mSleepClusterNeighbours.insert(mSleepClusterNeighbours.end(),
+                                               clusterNeighbours.begin(), clusterNeighbours.end());
+                mSleepClusterNeighbourOffsets.push_back(static_cast<uint>(mSleepClusterNeighbours.size()));
+            }
+        }
+
+        std::vector<uint> vertexSlotOffsets, vertexSlots;
+        MeshLoader::CalcVertexConstraintSlots(edges, static_cast<uint>(mNumVertices),
+                                              vertexSlotOffsets, vertexSlots);
+        for (uint i = 0; i < mNumVertices; ++i) {
+            if (vertexSlotOffsets[i + 1] == vertexSlotOffsets[i]) mHasUnconstrainedVertices = true;
+        }
+
+        /// Split the constraints into partitions that are projected in local memory
+        std::vector<ConstraintPartition> partitions;
+        std::vector<uint> partitionVertices;
+        std::vector<PartitionConstraint> partitionStretchConstraints, partitionBendConstraints;
+        MeshLoader::BuildConstraintPartitions(stretchConstraints, bendConstraints, static_cast<uint>(mNumVertices),
+                                              PARTITION_SIZE, partitions, partitionVertices,
+                                              partitionStretchConstraints, partitionBendConstraints);
+        mNumPartitions = partitions.size();
+        for (const auto &partition : partitions) {
+            mMaxPartitionVertices = std::max<unsigned long>(mMaxPartitionVertices, partition.numVertices);
+        }
+
+        const std::vector<glm::vec4> zeros(mNumVertices, glm::vec4(0.0f));
+
+        /// Create the device buffers
+        OCL_ERROR;
+
+        const cl_mem_flags copyFlags = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR;
+        OCL_CHECK(mPositionsBufferCL = cl::Buffer(context, copyFlags, sizeof(glm::vec4) * mNumVertices,
+                                                  positions.data(), CL_ERROR));
+        OCL_CHECK(mPredictedPositionsBufferCL = cl::Buffer(context, copyFlags, sizeof(glm::vec4) * mNumVertices,
+                                                           positions.data(), CL_ERROR));
+        OCL_CHECK(mVelocitiesBufferCL = cl::Buffer(context, copyFlags, sizeof(glm::vec4) * mNumVertices,
+                                                   (void *) zeros.data(), CL_ERROR));
+        OCL_CHECK(mPositionCorrectionsBufferCL = cl::Buffer(context, copyFlags, sizeof(glm::vec4) * mNumVertices,
+                                                            (void *) zeros.data(), CL_ERROR));
+        OCL_CHECK(mPreviousPredictedBufferCL = cl::Buffer(context, copyFlags, sizeof(glm::vec4) * mNumVertices,
+                                                          positions.data(), CL_ERROR));
+        OCL_CHECK(mVertexClothBufferCL = cl::Buffer(context, copyFlags, sizeof(ClothVertexData) * mNumVertices,
+                                                    clothVertices.data(), CL_ERROR));
+        OCL_CHECK(mDistToLineBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_float) * mNumVertices,
+                                                   (void *) 0, CL_ERROR));
+        OCL_CHECK(mRestPositionsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                      sizeof(glm::vec4) * mNumVertices, positions.data(), CL_ERROR));
+        OCL_CHECK(mVertexBinBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * mNumVertices,
+                                                  (void *) 0, CL_ERROR));
+        OCL_CHECK(mVertexInBinPosCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * mNumVertices,
+                                                 (void *) 0, CL_ERROR));
+        OCL_CHECK(mSortedVerticesBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * mNumVertices,
+                                                       (void *) 0, CL_ERROR));
+        OCL_CHECK(mSortedPositionsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(glm::vec4) * mNumVertices,
+                                                        (void *) 0, CL_ERROR));
+        OCL_CHECK(mSortedBinsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * mNumVertices,
+                                                   (void *) 0, CL_ERROR));
+        OCL_CHECK(mVertexSlotOffsetsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                          sizeof(cl_uint) * vertexSlotOffsets.size(),
+                                                          vertexSlotOffsets.data(), CL_ERROR));
+        OCL_CHECK(mVertexSlotsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                    sizeof(cl_uint) * vertexSlots.size(),
+                                                    vertexSlots.data(), CL_ERROR));
+
+        OCL_CHECK(mEdgeBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                             sizeof(Edge) * mNumEdges, edges.data(), CL_ERROR));
+        OCL_CHECK(mEdgeClothBufferCL = cl::Buffer(context, copyFlags, sizeof(ClothEdgeData) * mNumEdges,
+                                                  clothEdges.data(), CL_ERROR));
+        // zeroed, so that no slot is ever gathered uninitialized
+        const std::vector<glm::vec4> zeroDeltas(4 * mNumEdges, glm::vec4(0.0f));
+        OCL_CHECK(mConstraintDeltasBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                                         sizeof(cl_float3) * 4 * mNumEdges,
+                                                         (void *) zeroDeltas.data(), CL_ERROR));
+        OCL_CHECK(mLambdasBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_float2) * mNumEdges,
+                                                (void *) 0, CL_ERROR));
+        OCL_CHECK(mStretchConstraintsBufferCL = cl::Buffer(context, copyFlags,
+                                                           sizeof(StretchConstraint) * stretchConstraints.size(),
+                                                           stretchConstraints.data(), CL_ERROR));
+        OCL_CHECK(mViolationBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_float) * 2,
+                                                  (void *) 0, CL_ERROR));
+        if (!bendConstraints.empty()) {
+            OCL_CHECK(mBendConstraintsBufferCL = cl::Buffer(context, copyFlags,
+                                                            sizeof(BendConstraint) * bendConstraints.size(),
+                                                            bendConstraints.data(), CL_ERROR));
+        }
+
+        OCL_CHECK(mTriangleBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                 sizeof(Triangle) * mNumTriangles, triangles.data(), CL_ERROR));
+        OCL_CHECK(mTriangleClothBufferCL = cl::Buffer(context, copyFlags, sizeof(ClothTriangleData) * mNumTriangles,
+                                                      clothTriangles.data(), CL_ERROR));
+
+        OCL_CHECK(mClothRangesBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                    sizeof(ClothRange) * mClothRanges.size(),
+                                                    mClothRanges.data(), CL_ERROR));
+        OCL_CHECK(mEdgeBatchOffsetsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                         sizeof(cl_uint) * mEdgeBatchOffsets.size(),
+                                                         mEdgeBatchOffsets.data(), CL_ERROR));
+
+        /// Cloth index of every vertex, bounds and collision pairs for cloth-cloth collisions
+        std::vector<cl_uint> vertexClothIDs;
+        vertexClothIDs.reserve(mNumVertices);
+        for (uint k = 0; k < numCloths; ++k) {
+            vertexClothIDs.insert(vertexClothIDs.end(), mClothRanges[k].numVertices, k);
+        }
+        const std::vector<cl_uint> clothPairs(numCloths * numCloths, 0);
+        OCL_CHECK(mVertexClothIDsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                       sizeof(cl_uint) * mNumVertices,
+                                                       vertexClothIDs.data(), CL_ERROR));
+        OCL_CHECK(mClothBoundsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint8) * (numCloths + 1),
+                                                    (void *) 0, CL_ERROR));
+        OCL_CHECK(mClothPairsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                   sizeof(cl_uint) * clothPairs.size(),
+                                                   (void *) clothPairs.data(), CL_ERROR));
+
+        const std::vector<cl_uint> clusterZeros(numSleepClusters(), 0);
+        OCL_CHECK(mVertexSleepClusterBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                           sizeof(cl_uint) * mNumVertices,
+                                                           mVertexSleepClusters.data(), CL_ERROR));
+        OCL_CHECK(mSleepClusterSpeedsBufferCL = cl::Buffer(context, copyFlags, sizeof(cl_uint) * numSleepClusters(),
+                                                           (void *) clusterZeros.data(), CL_ERROR));
+        OCL_CHECK(mSleepClusterCalmFramesBufferCL = cl::Buffer(context, copyFlags,
+                                                               sizeof(cl_uint) * numSleepClusters(),
+                                                               (void *) clusterZeros.data(), CL_ERROR));
+        OCL_CHECK(mActiveVerticesBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_uint) * mNumVertices,
+                                                       (void *) 0, CL_ERROR));
+        OCL_CHECK(mActiveStretchConstraintsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY,
+                                                                 sizeof(cl_uint) * stretchConstraints.size(),
+                                                                 (void *) 0, CL_ERROR));
+        if (!bendConstraints.empty()) {
+            OCL_CHECK(mActiveBendConstraintsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY,
+                                                                  sizeof(cl_uint) * bendConstraints.size(),
+                                                                  (void *) 0, CL_ERROR));
+        }
+
+        if (!partitions.empty()) {
+            OCL_CHECK(mPartitionsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                       sizeof(ConstraintPartition) * partitions.size(),
+                                                       partitions.data(), CL_ERROR));
+        }
+        if (!partitionVertices.empty()) {
+            OCL_CHECK(mPartitionVerticesBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                              sizeof(cl_uint) * partitionVertices.size(),
+                                                              partitionVertices.data(), CL_ERROR));
+        }
+        if (!partitionStretchConstraints.empty()) {
+            OCL_CHECK(mPartitionStretchConstraintsBufferCL = cl::Buffer(
+                    context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                    sizeof(PartitionConstraint) * partitionStretchConstraints.size(),
+                    partitionStretchConstraints.data(), CL_ERROR));
+        }
+        if (!partitionBendConstraints.empty()) {
+            OCL_CHECK(mPartitionBendConstraintsBufferCL = cl::Buffer(
+                    context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                    sizeof(PartitionConstraint) * partitionBendConstraints.size(),
+                    partitionBendConstraints.data(), CL_ERROR));
+        }
+
+        mStretchConstraints = std::move(stretchConstraints);
+        mBendConstraints = std::move(bendConstraints);
+
+        if (!levelVertices.empty()) {
+            OCL_CHECK(mLevelVerticesBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                          sizeof(cl_uint) * levelVertices.size(),
+                                                          levelVertices.data(), CL_ERROR));
+            OCL_CHECK(mLevelPositionsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                                           sizeof(cl_float3) * levelVertices.size(),
+                                                           (void *) 0, CL_ERROR));
+            OCL_CHECK(mLevelConstraintsBufferCL = cl::Buffer(context, copyFlags,
+                                                             sizeof(StretchConstraint) * levelConstraints.size(),
+                                                             levelConstraints.data(), CL_ERROR));
+            OCL_CHECK(mLevelStencilsBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                          sizeof(ProlongationStencil) * levelStencils.size(),
+                                                          levelStencils.data(), CL_ERROR));
+        }
+    }
+
+    uint ClothArena::findCloth(uint vertexID) const {
+        auto it = std::upper_bound(mClothRanges.begin(), mClothRanges.end(), vertexID,
+                                   [](uint id, const ClothRange &range) { return id < range.vertexOffset; });
+        return static_cast<uint>(it - mClothRanges.begin()) - 1;
+    }
+
+    uint ClothArena::findSleepCluster(uint vertexID) const {
+        return mVertexSleepClusters[vertexID];
+    }
+
+    void ClothArena::updateActiveLists(cl::CommandQueue &queue, const std::vector<bool> &isClusterAsleep) {
+        auto isAwake = [&](int vertexID) { return !isClusterAsleep[mVertexSleepClusters[vertexID]]; };
+
+        std::vector<cl_uint> activeVertices, activeStretchConstraints, activeBendConstraints;
+        for (uint c = 0; c < numSleepClusters(); ++c) {
+            if (isClusterAsleep[c]) continue;
+            for (uint v = mSleepClusterOffsets[c]; v < mSleepClusterOffsets[c + 1]; ++v) {
+                activeVertices.push_back(v);
+            }
+        }
+
+        // constraints between an awake and a sleeping cluster are projected, the sleeping
+        // vertices are not corrected and act as if they were pinned
+        for (uint i = 0; i < mStretchConstraints.size(); ++i) {
+            const auto &stretch = mStretchConstraints[i];
+            if (isAwake(stretch.vertices[0]) || isAwake(stretch.vertices[1])) {
+                activeStretchConstraints.push_back(i);
+            }
+        }
+
+        for (uint i = 0; i < mBendConstraints.size(); ++i) {
+            const auto &bend = mBendConstraints[i];
+            if (isAwake(bend.vertices[0]) || isAwake(bend.vertices[1])
+                || isAwake(bend.vertices[2]) || isAwake(bend.vertices[3])) {
+                activeBendConstraints.push_back(i);
+            }
+        }
+
+        mNumActiveVertices = activeVertices.size();
+        mNumActiveStretchConstraints = activeStretchConstraints.size();
+        mNumActiveBendConstraints = activeBendConstraints.size();
+
+        // the active lists only change when a cluster falls asleep or wakes up, so blocking writes are fine
+        if (!activeVertices.empty()) {
+            OCL_CALL(queue.enqueueWriteBuffer(mActiveVerticesBufferCL, CL_TRUE, 0,
+                                              sizeof(cl_uint) * activeVertices.size(), activeVertices.data()));
+        }
+        if (!activeStretchConstraints.empty()) {
+            OCL_CALL(queue.enqueueWriteBuffer(mActiveStretchConstraintsBufferCL, CL_TRUE, 0,
+                                              sizeof(cl_uint) * activeStretchConstraints.size(),
+                                              activeStretchConstraints.data()));
+        }
+        if (!activeBendConstraints.empty()) {
+            OCL_CALL(queue.enqueueWriteBuffer(mActiveBendConstraintsBufferCL, CL_TRUE, 0,
+                                              sizeof(cl_uint) * activeBendConstraints.size(),
+                                              activeBendConstraints.data()));
+        }
+    }
+
+    unsigned long ClothArena::numActiveVertices() const {
+        return mNumActiveVertices;
+    }
+
+    unsigned long ClothArena::numActiveStretchConstraints() const {
+        return mNumActiveStretchConstraints;
+    }
+
+    unsigned long ClothArena::numActiveBendConstraints() const {
+        return mNumActiveBendConstraints;
+    }
+
+    unsigned long ClothArena::numPartitions() const {
+        return mNumPartitions;
+    }
+
+    unsigned long ClothArena::maxPartitionVertices() const {
+        return mMaxPartitionVertices;
+    }
+
+    unsigned long ClothArena::numSleepClusters() const {
+        return mSleepClusterOffsets.size() - 1;
+    }
+
+    uint ClothArena::edgeBatchBegin(uint color, uint cloth) const {
+        return mEdgeBatchOffsets[color * (numCloths() + 1) + cloth];
+    }
+
+    unsigned long ClothArena::numCloths() const {
+        return mClothRanges.size();
+    }
+
+    unsigned long ClothArena::numVertices() const {
+        return mNumVertices;
+    }
+
+    unsigned long ClothArena::numEdges() const {
+        return mNumEdges;
+    }
+
+    unsigned long ClothArena::numTriangles() const {
+        return mNumTriangles;
+    }
+
+    unsigned long ClothArena::numEdgeColors() const {
+        return mNumEdgeColors;
+    }
+
+    unsigned long ClothArena::numStretchConstraints() const {
+        return mNumEdges;
+    }
+
+    unsigned long ClothArena::numBendConstraints() const {
+        return mNumBendConstraints;
+    }
+
+    float ClothArena::meanRestEdgeLength() const {
+        return mMeanRestEdgeLength;
+    }
+
+    bool ClothArena::hasUnconstrainedVertices() const {
+        return mHasUnconstrainedVertices;
+    }
+
+    unsigned long ClothArena::numMultigridLevels() const {
+        return mNumMultigridLevels;
+    }
+
+    uint ClothArena::numMultigridLevels(uint cloth) const {
+        // a cloth's levels are never empty, so its first empty level range ends its hierarchy
+        uint level = 1;
+        while (level <= mNumMultigridLevels && levelVertexBegin(level, cloth) != levelVertexBegin(level, cloth + 1)) {
+            ++level;
+        }
+        return level - 1;
+    }
+
+    uint ClothArena::levelVertexBegin(uint level, uint cloth) const {
+        return levelBegin(mLevelVertexOffsets, level, cloth);
+    }
+
+    uint ClothArena::levelConstraintBegin(uint level, uint cloth) const {
+        return levelBegin(mLevelConstraintOffsets, level, cloth);
+    }
+
+    uint ClothArena::levelStencilBegin(uint level, uint cloth) const {
+        return levelBegin(mLevelStencilOffsets, level, cloth);
+    }
+
+    uint ClothArena::levelBegin(const std::vector<uint> &offsets, uint level, uint cloth) const {
+        return offsets[(level - 1) * (numCloths() + 1) + cloth];
+    }
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <CL/cl.hpp>
+
+#include <geometry/Mesh.hpp>
+#include <simulation/geometry.hpp>
+
+namespace pbd {
+    /**
+     * Device (OpenCL) simulation state of every cloth in a scene, packed into
+     * shared buffers so that each simulation stage is a single NDRange over all
+     * cloths. Vertex, edge and triangle IDs are rebased to the shared buffers.
+     *
+     * Edges are ordered by color first and by cloth second, so edge color c of
+     * cloth k spans [edgeBatchBegin(c, k), edgeBatchBegin(c, k + 1)) and edge
+     * color c of all cloths spans [edgeBatchBegin(c, 0), edgeBatchBegin(c, numCloths())).
+     */
+    class ClothArena {
+    public:
+        /// Max number of vertices of a sleep cluster
+        static const uint SLEEP_CLUSTER_SIZE = 256;
+
+        /// Max number of vertices that a constraint partition owns. With the halo vertices, the local
+        /// state of a partition of a regular cloth is around 12 KB, so that a few work-groups fit per compute unit
+        static const uint PARTITION_SIZE = 256;
+
+        /**
+         * Packs the host data of the cloths into device buffers. Must be
+         * called before ClothMesh::clearHostData on any of the cloths.
+         */
+        ClothArena(cl::Context &context, const std::vector<std::shared_ptr<ClothMesh>> &cloths);
+
+        /**
+         * Returns the index of the cloth that the shared vertex ID belongs to.
+         */
+        uint findCloth(uint vertexID) const;
+
+        /**
+         * Returns the offset of edge color c of cloth k into the shared edges.
+         */
+        uint edgeBatchBegin(uint color, uint cloth) const;
+
+        unsigned long numCloths() const;
+
+        unsigned long numVertices() const;
+
+        unsigned long numEdges() const;
+
+        unsigned long numTriangles() const;
+
+        unsigned long numEdgeColors() const;
+
+        unsigned long numStretchConstraints() const;
+
+        unsigned long numBendConstraints() const;
+
+        /**
+         * Returns the mean rest length of the stretch constraints of all cloths (m).
+         */
+        float meanRestEdgeLength() const;
+
+        /**
+         * Returns true if any vertex belongs to no edge, so that no constraint projection reads it.
+         */
+        bool hasUnconstrainedVertices() const;
+
+        /**
+         * Returns the max number of coarse multigrid levels of any cloth.
+         */
+        unsigned long numMultigridLevels() const;
+
+        /**
+         * Returns the number of coarse multigrid levels of cloth k.
+         */
+        uint numMultigridLevels(uint cloth) const;
+
+        /**
+         * Returns the offset of coarse multigrid level l (1 = finest coarse level) of cloth k into the
+         * shared level vertices, so level l of cloth k spans [levelVertexBegin(l, k), levelVertexBegin(l, k + 1)).
+         * Cloths without level l have an empty range.
+         */
+        uint levelVertexBegin(uint level, uint cloth) const;
+
+        /**
+         * Returns the offset of coarse multigrid level l of cloth k into the shared level constraints.
+         */
+        uint levelConstraintBegin(uint level, uint cloth) const;
+
+        /**
+         * Returns the offset of coarse multigrid level l of cloth k into the shared prolongation stencils.
+         */
+        uint levelStencilBegin(uint level, uint cloth) const;
+
+        /**
+         * Returns the number of sleep clusters, blocks of up to SLEEP_CLUSTER_SIZE consecutive
+         * vertices of a single cloth that fall asleep and wake up together. Sleep cluster c spans
+         * the vertices [mSleepClusterOffsets[c], mSleepClusterOffsets[c + 1]), the sleep clusters of
+         * cloth k are [mClothSleepClusterOffsets[k], mClothSleepClusterOffsets[k + 1]).
+         */
+        unsigned long numSleepClusters() const;
+
+        /**
+         * Returns the index of the sleep cluster that the shared vertex ID belongs to.
+         */
+        uint findSleepCluster(uint vertexID) const;
+
+        /**
+         * Rebuilds the compacted lists of the vertices of awake sleep clusters, and of the stretch and
+         * bend constraints that move at least one of them, and uploads them to the device.
+         */
+        void updateActiveLists(cl::CommandQueue &queue, const std::vector<bool> &isClusterAsleep);
+
+        unsigned long numActiveVertices() const;
+
+        unsigned long numActiveStretchConstraints() const;
+
+        unsigned long numActiveBendConstraints() const;
+
+        /**
+         * Returns the number of constraint partitions, see MeshLoader::BuildConstraintPartitions.
+         */
+        unsigned long numPartitions() const;
+
+        /**
+         * Returns the max number of local (owned and halo) vertices of any constraint partition.
+         */
+        unsigned long maxPartitionVertices() const;
+
+        std::vector<ClothRange> mClothRanges;
+
+        std::vector<uint> mSleepClusterOffsets;
+        std::vector<uint> mClothSleepClusterOffsets;
+
+        /// CSR adjacency of the sleep clusters that share a stretch constraint, the neighbours of cluster c
+        /// are mSleepClusterNeighbours[mSleepClusterNeighbourOffsets[c]] to [mSleepClusterNeighbourOffsets[c + 1] - 1]
+        std::vector<uint> mSleepClusterNeighbourOffsets;
+        std::vector<uint> mSleepClusterNeighbours;
+
+        /// numEdgeColors() x (numCloths() + 1) table of edge batch offsets, see #edgeBatchBegin
+        std::vector<uint> mEdgeBatchOffsets;
+
+        /// Per-vertex simulation state
+        cl::Buffer mPositionsBufferCL;
+        cl::Buffer mPredictedPositionsBufferCL;
+        cl::Buffer mVelocitiesBufferCL;
+        cl::Buffer mPositionCorrectionsBufferCL;
+        cl::Buffer mPreviousPredictedBufferCL; // predictions of the previous substep, for Chebyshev acceleration
+        cl::Buffer mVertexClothBufferCL;
+        cl::Buffer mDistToLineBufferCL;
+        cl::Buffer mRestPositionsBufferCL; // positions at load time, see kernels/counting_sort.cl -> collide_particles
+        cl::Buffer mVertexBinBufferCL;
+        cl::Buffer mVertexInBinPosCL;
+        cl::Buffer mVertexSlotOffsetsBufferCL;
+        cl::Buffer mVertexSlotsBufferCL;
+
+        /// The vertex IDs and predicted positions in the order of their grid bins, see ClothSimulationScene::mGridCL
+        cl::Buffer mSortedVerticesBufferCL;
+        cl::Buffer mSortedPositionsBufferCL;
+        cl::Buffer mSortedBinsBufferCL; // the keys of the radix sort by bin, see ClothSimParams::useRadixSort
+
+        /// Per-edge simulation state
+        cl::Buffer mEdgeBufferCL;
+        cl::Buffer mEdgeClothBufferCL;
+        cl::Buffer mConstraintDeltasBufferCL; // 4 float3 slots per edge
+        cl::Buffer mLambdasBufferCL; // XPBD Lagrange multipliers [stretch, bend] per edge
+
+        /// Compacted constraint streams, one stretch constraint per edge and
+        /// one bend constraint per edge that is shared by two triangles
+        cl::Buffer mStretchConstraintsBufferCL;
+        cl::Buffer mBendConstraintsBufferCL;
+
+        /// [max, sum of squares] of the relative stretch, see calc_constraint_violation
+        cl::Buffer mViolationBufferCL;
+
+        /// Per-triangle simulation state
+        cl::Buffer mTriangleBufferCL;
+        cl::Buffer mTriangleClothBufferCL;
+
+        /// Per-cloth tables
+        cl::Buffer mClothRangesBufferCL;
+        cl::Buffer mEdgeBatchOffsetsBufferCL;
+
+        /// Cloth-cloth collisions, see kernels/predict_positions.cl -> calc_cloth_bounds and
+        /// kernels/counting_sort.cl -> collide_particles
+        cl::Buffer mVertexClothIDsBufferCL; // index of the cloth of every vertex
+        cl::Buffer mClothBoundsBufferCL; // 8 uints per cloth and for the scene, [min xyz, max speed, max xyz, unused]
+        cl::Buffer mClothPairsBufferCL; // numCloths() x numCloths(), != 0 if the cloths collide
+
+        /// Coarse multigrid levels of all cloths, level-major and cloth-minor, only created if any
+        /// cloth has a multigrid hierarchy. Stencil parents index the shared level vertices
+        cl::Buffer mLevelVerticesBufferCL;
+        cl::Buffer mLevelPositionsBufferCL; // predicted positions of the level vertices, see restrict_positions
+        cl::Buffer mLevelConstraintsBufferCL;
+        cl::Buffer mLevelStencilsBufferCL;
+
+        /// Sleep state, see kernels/predict_positions.cl -> calc_cluster_speeds, count_calm_frames
+        cl::Buffer mVertexSleepClusterBufferCL;
+        cl::Buffer mSleepClusterSpeedsBufferCL;
+        cl::Buffer mSleepClusterCalmFramesBufferCL;
+
+        /// Compacted active element lists, see #updateActiveLists
+        cl::Buffer mActiveVerticesBufferCL;
+        cl::Buffer mActiveStretchConstraintsBufferCL;
+        cl::Buffer mActiveBendConstraintsBufferCL;
+
+        /// Constraint partitions, see kernels/cloth_simulation.cl -> calc_partition_position_corrections
+        cl::Buffer mPartitionsBufferCL;
+        cl::Buffer mPartitionVerticesBufferCL;
+        cl::Buffer mPartitionStretchConstraintsBufferCL;
+        cl::Buffer mPartitionBendConstraintsBufferCL;
+
+    private:
+        uint levelBegin(const std::vector<uint> &offsets, uint level, uint cloth) const;
+
+        unsigned long mNumVertices, mNumEdges, mNumTriangles, mNumEdgeColors, mNumBendConstraints;
+        unsigned long mNumMultigridLevels;
+        float mMeanRestEdgeLength;
+        bool mHasUnconstrainedVertices;
+
+        /// numMultigridLevels() x (numCloths() + 1) tables of level offsets
+        std::vector<uint> mLevelVertexOffsets, mLevelConstraintOffsets, mLevelStencilOffsets;
+
+        /// Host copies of the data that the active lists are built from
+        std::vector<uint> mVertexSleepClusters;
+        std::vector<StretchConstraint> mStretchConstraints;
+        std::vector<BendConstraint> mBendConstraints;
+
+        unsigned long mNumActiveVertices, mNumActiveStretchConstraints, mNumActiveBendConstraints;
+
+        unsigned long mNumPartitions, mMaxPartitionVertices;
+    };
+}
@@ -1,8 +1,10 @@
 #include "ClothSimParams.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <bwgl/bwgl.hpp>
 #include <json.hpp>
+#include <util/cl_util.hpp>
 
 using json = nlohmann::json;
 
@@ -18,6 +20,35 @@ namespace pbd {
         params.numSubSteps  = j["numSubSteps"];
         params.k_bend       = j["k_bend"];
         params.k_stretch    = j["k_stretch"];
+        params.solverMode   = static_cast<SolverMode>(j.value("solverMode", 0u));
+        params.fuseSubSteps = j.value("fuseSubSteps", 0u);
+        params.useLocalSolver = j.value("useLocalSolver", 1u);
+        params.compliance_stretch = j.value("compliance_stretch", 0.0001f);
+        params.compliance_bend = j.value("compliance_bend", 0.5f);
+        params.bendInterval = j.value("bendInterval", 1u);
+        params.convergenceCheckInterval = j.value("convergenceCheckInterval", 0u);
+        params.convergenceTolerance = j.value("convergenceTolerance", 0.001f);
+        params.useChebyshev = j.value("useChebyshev", 0u);
+        params.spectralRadius = j.value("spectralRadius", 0.95f);
+        params.chebyshevWarmUp = j.value("chebyshevWarmUp", 5u);
+        params.overRelaxation = j.value("overRelaxation", 1.0f);
+        params.multigridSmoothingSteps = j.value("multigridSmoothingSteps", 1u);
+        params.multigridCoarseSteps = j.value("multigridCoarseSteps", 4u);
+        params.useSleeping = j.value("useSleeping", 0u);
+        params.sleepSpeed = j.value("sleepSpeed", 0.05f);
+        params.sleepFrames = j.value("sleepFrames", 30u);
+        params.useSmallSteps = j.value("useSmallSteps", 0u);
+        params.usePartitions = j.value("usePartitions", 1u);
+        params.useSelfCollision = j.value("useSelfCollision", 0u);
+        params.collisionDistance = j.value("collisionDistance", 0.02f);
+        params.collideEverySubStep = j.value("collideEverySubStep", 0u);
+        params.useClothCollision = j.value("useClothCollision", 0u);
+        params.useTriangleBVH = j.value("useTriangleBVH", 0u);
+        params.bvhRebuildRatio = j.value("bvhRebuildRatio", 1.5f);
+        params.useHashGrid = j.value("useHashGrid", 1u);
+        params.hashGridBucketsPerVertex = j.value("hashGridBucketsPerVertex", 2.0f);
+        params.useAdaptiveGrid = j.value("useAdaptiveGrid", 0u);
+        params.useRadixSort = j.value("useRadixSort", 1u);
 
         return params;
     }
@@ -29,11 +60,65 @@ namespace pbd {
         j["numSubSteps"]    = numSubSteps;
         j["k_bend"]         = k_bend;
         j["k_stretch"]      = k_stretch;
+        j["solverMode"]     = static_cast<cl_uint>(solverMode);
+        j["fuseSubSteps"]   = fuseSubSteps;
+        j["useLocalSolver"] = useLocalSolver;
+        j["compliance_stretch"] = compliance_stretch;
+        j["compliance_bend"] = compliance_bend;
+        j["bendInterval"] = bendInterval;
+        j["convergenceCheckInterval"] = convergenceCheckInterval;
+        j["convergenceTolerance"] = convergenceTolerance;
+        j["useChebyshev"] = useChebyshev;
+        j["spectralRadius"] = spectralRadius;
+        j["chebyshevWarmUp"] = chebyshevWarmUp;
+        j["overRelaxation"] = overRelaxation;
+        j["multigridSmoothingSteps"] = multigridSmoothingSteps;
+        j["multigridCoarseSteps"] = multigridCoarseSteps;
+        j["useSleeping"] = useSleeping;
+        j["sleepSpeed"] = sleepSpeed;
+        j["sleepFrames"] = sleepFrames;
+        j["useSmallSteps"] = useSmallSteps;
+        j["usePartitions"] = usePartitions;
+        j["useSelfCollision"] = useSelfCollision;
+        j["collisionDistance"] = collisionDistance;
+        j["collideEverySubStep"] = collideEverySubStep;
+        j["useClothCollision"] = useClothCollision;
+        j["useTriangleBVH"] = useTriangleBVH;
+        j["bvhRebuildRatio"] = bvhRebuildRatio;
+        j["useHashGrid"] = useHashGrid;
+        j["hashGridBucketsPerVertex"] = hashGridBucketsPerVertex;
+        j["useAdaptiveGrid"] = useAdaptiveGrid;
+        j["useRadixSort"] = useRadixSort;
 
         std::ofstream file(filename);
 
         file << j.dump(2) << std::endl;
         file.close();
     }
+
+    std::string ClothSimParams::getDefinesCL() const {
+        using std::to_string;
+
+        const bool bendEnabled = solverMode == SolverMode::XPBD_COLORED || k_bend != 0.0f;
+
+        /// only discrete parameters are baked in, so that dragging a stiffness slider doesn't compile a variant per value
+        const std::string args[8] = {
+                "SPECIALIZED",          "1",
+                "SPEC_NUM_SUBSTEPS",    to_string(numSubSteps) + "u",
+                "SPEC_FUSE_SUBSTEPS",   to_string(fuseSubSteps) + "u",
+                "SPEC_BEND_ENABLED",    bendEnabled ? "1" : "0"
+        };
+
+        return util::ConvertToCLDefines(4, args);
+    }
+
+    ClothSimParams ClothSimParams::getStepParams() const {
+        ClothSimParams params = *this;
+        if (!useSmallSteps || numSubSteps == 0) return params;
+
+        params.deltaTime = deltaTime / numSubSteps;
+        params.numSubSteps = 1;
+        return params;
+    }
 }
 
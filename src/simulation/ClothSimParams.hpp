@@ -4,11 +4,44 @@
 #include <CL/cl.hpp>
 
 namespace pbd {
+    /**
+     * How the cloth constraints are projected in each substep.
+     * Matches the solverMode field of ClothSimParams in kernels/cloth_simulation.cl
+     */
+    enum class SolverMode : cl_uint {
+        // One work-item per edge, corrections are accumulated with atomics and applied afterwards
+        JACOBI_ATOMIC = 0,
+
+        // One conflict-free pass per edge color, corrections are applied directly
+        GAUSS_SEIDEL_COLORED = 1,
+
+        // Edges write their corrections to per-constraint slots, then every vertex gathers its
+        // slots in a fixed order. No atomics, and bit-reproducible results
+        JACOBI_GATHER = 2,
+
+        // Like GAUSS_SEIDEL_COLORED, but with XPBD compliant constraints and per-edge Lagrange
+        // multipliers, so that the stiffness does not depend on numSubSteps or deltaTime
+        XPBD_COLORED = 3
+    };
+
     struct ClothSimParams {
         static ClothSimParams ReadFromFile(const std::string &filename);
 
         void writeToFile(const std::string &filename);
 
+        /**
+         * Gets the parameters that are baked into specialized variants of
+         * kernels/cloth_simulation.cl as OpenCL #defines.
+         */
+        std::string getDefinesCL() const;
+
+        /**
+         * Gets the parameters of a single integration step. With useSmallSteps, the frame is split into
+         * numSubSteps steps of deltaTime / numSubSteps with one projection iteration each, otherwise
+         * these are the parameters themselves.
+         */
+        ClothSimParams getStepParams() const;
+
         // Number of PBD constraint projection steps
         cl_uint numSubSteps;
 
@@ -20,5 +53,95 @@ namespace pbd {
 
         // PBD stiffness constant for cloth bending constraint
         cl_float k_bend;
+
+        // How the constraints are projected
+        SolverMode solverMode;
+
+        // If != 0, ground clipping is folded into the projection kernels instead of its own launch
+        cl_uint fuseSubSteps;
+
+        // If != 0, cloths that fit in local memory are solved by a single persistent work-group,
+        // only used by SolverMode::GAUSS_SEIDEL_COLORED
+        cl_uint useLocalSolver;
+
+        // XPBD compliance (inverse stiffness) for cloth stretch constraint, only used by SolverMode::XPBD_COLORED
+        cl_float compliance_stretch;
+
+        // XPBD compliance (inverse stiffness) for cloth bending constraint, only used by SolverMode::XPBD_COLORED
+        cl_float compliance_bend;
+
+        // Bend constraints are projected every bendInterval-th substep, only used by SolverMode::JACOBI_ATOMIC
+        cl_uint bendInterval;
+
+        // The constraint violation is checked every convergenceCheckInterval-th substep, 0 = never
+        cl_uint convergenceCheckInterval;
+
+        // The substeps of a frame stop once the max relative stretch of any edge is below this
+        cl_float convergenceTolerance;
+
+        // If != 0, the JACOBI_ATOMIC substeps are accelerated by the Chebyshev semi-iterative method
+        cl_uint useChebyshev;
+
+        // Estimated spectral radius (0 < rho < 1) of the Jacobi iteration, determines the Chebyshev weights
+        cl_float spectralRadius;
+
+        // Number of plain Jacobi substeps per frame before the Chebyshev acceleration starts
+        cl_uint chebyshevWarmUp;
+
+        // Scale of the Jacobi position corrections, > 1 over-relaxes and < 1 under-relaxes
+        cl_float overRelaxation;
+
+        // Jacobi iterations on every intermediate level of a multigrid V-cycle, see MeshLoader::BuildMultigridLevels
+        cl_uint multigridSmoothingSteps;
+
+        // Jacobi iterations on the coarsest level of a multigrid V-cycle
+        cl_uint multigridCoarseSteps;
+
+        // If != 0, resting sleep clusters (see ClothArena) are skipped, only used by SolverMode::JACOBI_ATOMIC
+        cl_uint useSleeping;
+
+        // A sleep cluster is calm in a frame if all of its vertices are slower than this (m/s)
+        cl_float sleepSpeed;
+
+        // A sleep cluster falls asleep after this many consecutive calm frames
+        cl_uint sleepFrames;
+
+        // If != 0, every frame is numSubSteps predict/project/update steps with one projection iteration each
+        cl_uint useSmallSteps;
+
+        // If != 0, SolverMode::JACOBI_ATOMIC projects the constraints per partition in local memory, see ClothArena
+        cl_uint usePartitions;
+
+        // If != 0, vertices that come closer than collisionDistance are pushed apart, see kernels/counting_sort.cl
+        cl_uint useSelfCollision;
+
+        // Min distance between two vertices of a cloth that aren't neighbours at rest (m), at most the grid bin size
+        cl_float collisionDistance;
+
+        // If != 0, the collisions are resolved after every substep instead of once per step
+        cl_uint collideEverySubStep;
+
+        // If != 0, vertices of different cloths whose bounds overlap are pushed apart like self-collisions
+        cl_uint useClothCollision;
+
+        // If != 0, a linear BVH over the triangles of every cloth is refitted every frame, see TriangleBVH
+        cl_uint useTriangleBVH;
+
+        // The BVH is rebuilt once the surface area of its internal nodes has grown by this factor since its last build
+        cl_float bvhRebuildRatio;
+
+        // If != 0, the collision grid is an unbounded grid whose cells are hashed into a table, see pbd::Grid
+        cl_uint useHashGrid;
+
+        // Size of the hash table per collision vertex, rounded up to a power of two
+        cl_float hashGridBucketsPerVertex;
+
+        // If != 0, the collision grid is fitted every frame to the bounds of the scene and its bin size to the
+        // mean rest edge length, see ClothSimulationScene::updateGrid
+        cl_uint useAdaptiveGrid;
+
+        // If != 0, the collision vertices are sorted by bin with a stable radix sort, so that their order and the
+        // collision results are the same on every run, otherwise in the order of atomic increments
+        cl_uint useRadixSort;
     };
 }
@@ -1,32 +1,21 @@
 #pragma once
 
 #include <CL/cl.hpp>
-#include "util/cl_util.hpp"
+#include <geometry/geometry.hpp>
 
 namespace pbd {
-    struct Grid {
-        std::string getDefinesCL();
-
-        cl_float3 halfDimensions;
+    /**
+     * Host (CPU) representation of the collision grid, passed by value to the kernels of
+     * kernels/counting_sort.cl, so that it can change every frame without recompiling them.
+     * Matches the memory layout of the Grid struct in kernels/counting_sort.cl
+     */
+    struct ATTR_PACKED Grid {
+        cl_float origin[3]; // Lower corner of a bounded grid, unused by a hashed grid
         cl_float binSize;
-        cl_uint3 binCount3D;
-        cl_uint binCount;
-    };
-
-    inline std::string Grid::getDefinesCL() {
-        using std::to_string;
+        cl_uint binCount3D[3]; // of a bounded grid, unused by a hashed grid
+        cl_uint binCount; // the number of bins, or of hash table buckets (a power of two) of a hashed grid
 
-        const std::string args[16] = {
-                "halfDimsX",  to_string(halfDimensions.s[0]) + "f",
-                "halfDimsY",  to_string(halfDimensions.s[1]) + "f",
-                "halfDimsZ",  to_string(halfDimensions.s[2]) + "f",
-                "binSize",          to_string(binSize) + "f",
-                "binCountX",        to_string(binCount3D.s[0]),
-                "binCountY",        to_string(binCount3D.s[1]),
-                "binCountZ",        to_string(binCount3D.s[2]),
-                "binCount",         to_string(binCount)
-        };
-
-        return util::ConvertToCLDefines(8, args);
-    }
+        // If != 0, the grid is unbounded and its cells are hashed into binCount buckets
+        cl_uint isHashed;
+    };
 }
@@ -0,0 +1,54 @@
+#include "SdfColliders.hpp"
+
+#include <algorithm>
+
+#include <util/OCL_CALL.hpp>
+
+namespace pbd {
+    SdfColliders::SdfColliders(cl::Context &context, const std::vector<SignedDistanceField> &fields)
+            : mNumColliders(static_cast<uint>(fields.size())) {
+        const uint samplesPerBrick = SignedDistanceField::BRICK_SAMPLES * SignedDistanceField::BRICK_SAMPLES
+                                     * SignedDistanceField::BRICK_SAMPLES;
+
+        /// the brick tables are rebased to the shared bricks
+        std::vector<SdfCollider> colliders;
+        std::vector<uint> brickTable;
+        std::vector<float> brickSamples;
+        for (const SignedDistanceField &field : fields) {
+            SdfCollider collider;
+            for (int axis = 0; axis < 3; ++axis) {
+                collider.origin[axis] = field.origin[axis];
+                collider.numBricks[axis] = field.numBricks[axis];
+            }
+            collider.cellSize = field.cellSize;
+            collider.brickTableOffset = static_cast<uint>(brickTable.size());
+            colliders.push_back(collider);
+
+            const uint brickOffset = static_cast<uint>(brickSamples.size() / samplesPerBrick);
+            for (uint brick : field.brickTable) {
+                brickTable.push_back(brick == SignedDistanceField::EMPTY_BRICK ? brick : brickOffset + brick);
+            }
+            brickSamples.insert(brickSamples.end(), field.brickSamples.begin(), field.brickSamples.end());
+        }
+
+        // a collider without stored bricks (e.g. a degenerate mesh) still needs valid buffers
+        colliders.resize(std::max<::size_t>(colliders.size(), 1));
+        brickTable.resize(std::max<::size_t>(brickTable.size(), 1), SignedDistanceField::EMPTY_BRICK);
+        brickSamples.resize(std::max<::size_t>(brickSamples.size(), 1), 0.0f);
+
+        OCL_ERROR;
+        OCL_CHECK(mCollidersBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                  sizeof(SdfCollider) * colliders.size(), colliders.data(),
+                                                  CL_ERROR));
+        OCL_CHECK(mBrickTableBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                   sizeof(cl_uint) * brickTable.size(), brickTable.data(),
+                                                   CL_ERROR));
+        OCL_CHECK(mBrickSamplesBufferCL = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                     sizeof(cl_float) * brickSamples.size(), brickSamples.data(),
+                                                     CL_ERROR));
+    }
+
+    uint SdfColliders::numColliders() const {
+        return mNumColliders;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include <CL/cl.hpp>
+
+#include <geometry/SignedDistanceField.hpp>
+#include <simulation/geometry.hpp>
+
+namespace pbd {
+    /**
+     * Device (OpenCL) state of the static colliders of a scene, the bricks of their signed distance
+     * fields packed into shared buffers, so that every cloth vertex is tested against every collider
+     * in a single launch, see kernels/sdf_collision.cl.
+     */
+    class SdfColliders {
+    public:
+        SdfColliders(cl::Context &context, const std::vector<SignedDistanceField> &fields);
+
+        uint numColliders() const;
+
+        cl::Buffer mCollidersBufferCL; // SdfCollider per collider
+        cl::Buffer mBrickTableBufferCL; // index of every brick of every collider into the shared bricks
+        cl::Buffer mBrickSamplesBufferCL; // SignedDistanceField::BRICK_SAMPLES^3 floats per stored brick
+
+    private:
+        uint mNumColliders;
+    };
+}
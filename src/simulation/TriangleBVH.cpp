@@ -0,0 +1,148 @@
+#include "TriangleBVH.hpp"
+
+#include <algorithm>
+
+#include <util/cl_util.hpp>
+
+namespace pbd {
+    /// Must match MORTON_BITS in kernels/bvh.cl
+    static const uint MORTON_BITS = 10;
+
+    TriangleBVH::TriangleBVH(cl::Context &context, cl::Device &device, uint numTriangles)
+            : mNumTriangles(numTriangles), mNumBuilds(0), mSurfaceArea(0.0f), mHasSurfaceArea(false),
+              mIsSurfaceAreaOfBuild(false), mBuildSurfaceArea(0.0f) {
+        OCL_ERROR;
+
+        mProgram = util::LoadCLProgram("bvh.cl", context, device);
+        OCL_CHECK(mCalcCentroidBounds = util::make_unique<cl::Kernel>(*mProgram, "calc_centroid_bounds", CL_ERROR));
+        OCL_CHECK(mCalcMortonCodes = util::make_unique<cl::Kernel>(*mProgram, "calc_morton_codes", CL_ERROR));
+        OCL_CHECK(mBuildHierarchy = util::make_unique<cl::Kernel>(*mProgram, "build_hierarchy", CL_ERROR));
+        OCL_CHECK(mRefitBounds = util::make_unique<cl::Kernel>(*mProgram, "refit_bounds", CL_ERROR));
+
+        mMortonSort = util::make_unique<util::RadixSort>(context, device, numTriangles);
+
+        const uint numLeaves = std::max(numTriangles, 1u);
+        OCL_CHECK(mNodesBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(BVHNode) * (2 * numLeaves - 1),
+                                              (void *) 0, CL_ERROR));
+        OCL_CHECK(mParentsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * (2 * numLeaves - 1),
+                                                (void *) 0, CL_ERROR));
+        OCL_CHECK(mRefitCountersBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                                      sizeof(cl_uint) * std::max(numLeaves - 1, 1u),
+                                                      (void *) 0, CL_ERROR));
+        OCL_CHECK(mCentroidBoundsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * 6,
+                                                       (void *) 0, CL_ERROR));
+        OCL_CHECK(mMortonCodesBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * numLeaves,
+                                                    (void *) 0, CL_ERROR));
+        OCL_CHECK(mTriangleIDsBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * numLeaves,
+                                                    (void *) 0, CL_ERROR));
+        OCL_CHECK(mSurfaceAreaBufferCL = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_float),
+                                                    (void *) 0, CL_ERROR));
+    }
+
+    uint TriangleBVH::enqueueUpdate(cl::CommandQueue &queue, const cl::Buffer &triangles,
+                                    const cl::Buffer &positions, float padding, float rebuildRatio,
+                                    std::vector<cl::Event> *buildEvents, std::vector<cl::Event> *refitEvents) {
+        if (mNumTriangles == 0) return 0;
+
+        /// the surface area of the last refit is the baseline if it followed a build, otherwise
+        /// it tells how much the boxes have grown since
+        bool rebuild = mNumBuilds == 0;
+        if (mHasSurfaceArea) {
+            OCL_CALL(mSurfaceAreaReadEvent.wait());
+            if (mIsSurfaceAreaOfBuild) {
+                mBuildSurfaceArea = mSurfaceArea;
+            } else if (mSurfaceArea > rebuildRatio * mBuildSurfaceArea) {
+                rebuild = true;
+            }
+        }
+
+        uint numLaunches = 0;
+        if (rebuild) {
+            numLaunches += enqueueBuild(queue, triangles, positions, buildEvents);
+        }
+
+        /// fit every box to the current positions, bottom-up
+        cl::Event event;
+        OCL_CALL(queue.enqueueFillBuffer(mRefitCountersBufferCL, static_cast<cl_uint>(0), 0,
+                                         sizeof(cl_uint) * std::max(mNumTriangles - 1, 1u), NULL, &event));
+        if (refitEvents) refitEvents->push_back(event);
+        OCL_CALL(queue.enqueueFillBuffer(mSurfaceAreaBufferCL, static_cast<cl_float>(0.0f), 0, sizeof(cl_float),
+                                         NULL, &event));
+        if (refitEvents) refitEvents->push_back(event);
+
+        OCL_CALL(mRefitBounds->setArg(0, triangles));
+        OCL_CALL(mRefitBounds->setArg(1, positions));
+        OCL_CALL(mRefitBounds->setArg(2, mNodesBufferCL));
+        OCL_CALL(mRefitBounds->setArg(3, mParentsBufferCL));
+        OCL_CALL(mRefitBounds->setArg(4, mRefitCountersBufferCL));
+        OCL_CALL(mRefitBounds->setArg(5, mSurfaceAreaBufferCL));
+        OCL_CALL(mRefitBounds->setArg(6, mNumTriangles));
+        OCL_CALL(mRefitBounds->setArg(7, padding));
+        OCL_CALL(queue.enqueueNDRangeKernel(*mRefitBounds, cl::NullRange, cl::NDRange(mNumTriangles),
+                                            cl::NullRange, NULL, &event));
+        if (refitEvents) refitEvents->push_back(event);
+        ++numLaunches;
+
+        // non-blocking, mSurfaceArea is only read after waiting for mSurfaceAreaReadEvent
+        OCL_CALL(queue.enqueueReadBuffer(mSurfaceAreaBufferCL, false, 0, sizeof(cl_float), &mSurfaceArea,
+                                         NULL, &mSurfaceAreaReadEvent));
+        mHasSurfaceArea = true;
+        mIsSurfaceAreaOfBuild = rebuild;
+
+        return numLaunches;
+    }
+
+    uint TriangleBVH::numTriangles() const {
+        return mNumTriangles;
+    }
+
+    uint TriangleBVH::numBuilds() const {
+        return mNumBuilds;
+    }
+
+    uint TriangleBVH::enqueueBuild(cl::CommandQueue &queue, const cl::Buffer &triangles,
+                                   const cl::Buffer &positions, std::vector<cl::Event> *events) {
+        const cl::NDRange globalSize(mNumTriangles);
+        cl::Event event;
+
+        /// the Morton codes are relative to the bounds of the centroids, see calc_centroid_bounds
+        OCL_CALL(queue.enqueueFillBuffer(mCentroidBoundsBufferCL, static_cast<cl_uint>(0xFFFFFFFFu), 0,
+                                         sizeof(cl_uint) * 3, NULL, &event));
+        if (events) events->push_back(event);
+        OCL_CALL(queue.enqueueFillBuffer(mCentroidBoundsBufferCL, static_cast<cl_uint>(0u), sizeof(cl_uint) * 3,
+                                         sizeof(cl_uint) * 3, NULL, &event));
+        if (events) events->push_back(event);
+
+        OCL_CALL(mCalcCentroidBounds->setArg(0, triangles));
+        OCL_CALL(mCalcCentroidBounds->setArg(1, positions));
+        OCL_CALL(mCalcCentroidBounds->setArg(2, mCentroidBoundsBufferCL));
+        OCL_CALL(queue.enqueueNDRangeKernel(*mCalcCentroidBounds, cl::NullRange, globalSize, cl::NullRange,
+                                            NULL, &event));
+        if (events) events->push_back(event);
+
+        OCL_CALL(mCalcMortonCodes->setArg(0, triangles));
+        OCL_CALL(mCalcMortonCodes->setArg(1, positions));
+        OCL_CALL(mCalcMortonCodes->setArg(2, mCentroidBoundsBufferCL));
+        OCL_CALL(mCalcMortonCodes->setArg(3, mMortonCodesBufferCL));
+        OCL_CALL(mCalcMortonCodes->setArg(4, mTriangleIDsBufferCL));
+        OCL_CALL(queue.enqueueNDRangeKernel(*mCalcMortonCodes, cl::NullRange, globalSize, cl::NullRange,
+                                            NULL, &event));
+        if (events) events->push_back(event);
+
+        /// sort the triangles along the Morton curve, the hierarchy follows from the sorted codes
+        uint numLaunches = 2 + mMortonSort->enqueue(queue, mMortonCodesBufferCL, mTriangleIDsBufferCL,
+                                                    mNumTriangles, 3 * MORTON_BITS, events);
+
+        OCL_CALL(mBuildHierarchy->setArg(0, mMortonCodesBufferCL));
+        OCL_CALL(mBuildHierarchy->setArg(1, mTriangleIDsBufferCL));
+        OCL_CALL(mBuildHierarchy->setArg(2, mNodesBufferCL));
+        OCL_CALL(mBuildHierarchy->setArg(3, mParentsBufferCL));
+        OCL_CALL(mBuildHierarchy->setArg(4, mNumTriangles));
+        OCL_CALL(queue.enqueueNDRangeKernel(*mBuildHierarchy, cl::NullRange, globalSize, cl::NullRange,
+                                            NULL, &event));
+        if (events) events->push_back(event);
+
+        ++mNumBuilds;
+        return numLaunches + 1;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <CL/cl.hpp>
+
+#include <simulation/geometry.hpp>
+#include <util/RadixSort.hpp>
+
+namespace pbd {
+    /**
+     * Linear BVH over a triangle buffer, built and refitted on the device, see kernels/bvh.cl. A build sorts
+     * the triangles by the Morton codes of their centroids with a util::RadixSort and emits the hierarchy of
+     * all internal nodes in parallel (Karras 2012). Every update refits the boxes of the tree bottom-up to the
+     * current positions, which keeps the topology, and the tree is only rebuilt once the sum of the surface
+     * areas of its internal nodes has grown by rebuildRatio since the last build.
+     *
+     * mNodesBufferCL holds numTriangles - 1 internal nodes (the root is node 0) and numTriangles leaves.
+     */
+    class TriangleBVH {
+    public:
+        TriangleBVH(cl::Context &context, cl::Device &device, uint numTriangles);
+
+        /**
+         * Rebuilds the tree if it is not built yet or its quality degraded, then enqueues the refit of its
+         * boxes to positions, grown by padding on every side, and a non-blocking read of its surface area.
+         * @param buildEvents, refitEvents If not nullptr, the events of the build and refit launches are
+         *                                 appended to them
+         * @return The number of enqueued kernel launches
+         */
+        uint enqueueUpdate(cl::CommandQueue &queue, const cl::Buffer &triangles, const cl::Buffer &positions,
+                           float padding, float rebuildRatio,
+                           std::vector<cl::Event> *buildEvents = nullptr,
+                           std::vector<cl::Event> *refitEvents = nullptr);
+
+        uint numTriangles() const;
+
+        /**
+         * Returns the number of builds since the tree was created.
+         */
+        uint numBuilds() const;
+
+        cl::Buffer mNodesBufferCL; // BVHNode per node
+
+    private:
+        uint enqueueBuild(cl::CommandQueue &queue, const cl::Buffer &triangles, const cl::Buffer &positions,
+                          std::vector<cl::Event> *events);
+
+        std::unique_ptr<cl::Program> mProgram;
+        std::unique_ptr<cl::Kernel> mCalcCentroidBounds;
+        std::unique_ptr<cl::Kernel> mCalcMortonCodes;
+        std::unique_ptr<cl::Kernel> mBuildHierarchy;
+        std::unique_ptr<cl::Kernel> mRefitBounds;
+
+        std::unique_ptr<util::RadixSort> mMortonSort;
+
+        cl::Buffer mParentsBufferCL; // index of the parent of every node, -1 for the root
+        cl::Buffer mRefitCountersBufferCL; // per internal node, see refit_bounds
+        cl::Buffer mCentroidBoundsBufferCL; // [min xyz, max xyz] of the triangle centroids
+        cl::Buffer mMortonCodesBufferCL;
+        cl::Buffer mTriangleIDsBufferCL; // triangles in Morton order after a build
+        cl::Buffer mSurfaceAreaBufferCL;
+
+        uint mNumTriangles;
+        uint mNumBuilds;
+
+        cl_float mSurfaceArea; // of the internal nodes, from the last completed refit
+        cl::Event mSurfaceAreaReadEvent;
+        bool mHasSurfaceArea; // false until a refit has been enqueued
+        bool mIsSurfaceAreaOfBuild; // true if the last refit directly followed a build
+        float mBuildSurfaceArea; // of the internal nodes, right after the last build
+    };
+}
@@ -44,4 +44,130 @@ namespace pbd {
         int neighbourIDs[3];
         float mass;
     };
+
+    /**
+     * Host (CPU) representation of the range of a single cloth in the
+     * shared buffers of a ClothArena. Matches the memory layout of the
+     * ClothRange struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED ClothRange {
+        unsigned int vertexOffset;
+        unsigned int numVertices;
+        unsigned int numEdges;
+    };
+
+    /**
+     * Host (CPU) representation of a stretch constraint.
+     * Matches the memory layout of the StretchConstraint
+     * struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED StretchConstraint {
+        int vertices[2];
+        float restLength;
+    };
+
+    /**
+     * Host (CPU) representation of a bend constraint.
+     * Matches the memory layout of the BendConstraint
+     * struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED BendConstraint {
+        int vertices[4];
+        float restAngle;
+    };
+
+    /**
+     * Host (CPU) representation of the interpolation of a vertex that is not part of
+     * a coarse multigrid level from its coarse neighbours. Matches the memory layout
+     * of the ProlongationStencil struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED ProlongationStencil {
+        int vertexID;
+
+        /**
+         * Indices of the coarse neighbours into the vertices of the coarse level,
+         * -1 for unused parents. The weights of the used parents sum to 1.
+         */
+        int parents[4];
+        float weights[4];
+    };
+    /**
+     * Host (CPU) representation of a constraint partition, a patch of vertices whose stretch and bend
+     * constraints are projected by a single work-group in local memory. Matches the memory layout of
+     * the ConstraintPartition struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED ConstraintPartition {
+        /**
+         * The local vertices (every vertex that a constraint of the partition moves) are
+         * [vertexOffset, vertexOffset + numVertices) of the shared partition vertices. The first
+         * numInteriorVertices of them are moved by no other partition, the rest are boundary
+         * vertices of this partition or halo vertices that are owned by a neighbouring partition.
+         */
+        unsigned int vertexOffset;
+        unsigned int numVertices;
+        unsigned int numInteriorVertices;
+
+        unsigned int stretchOffset;
+        unsigned int numStretchConstraints;
+        unsigned int bendOffset;
+        unsigned int numBendConstraints;
+    };
+
+    /**
+     * Host (CPU) representation of a stretch or bend constraint of a partition.
+     * Matches the memory layout of the PartitionConstraint struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED PartitionConstraint {
+        unsigned int constraintID;
+
+        /**
+         * Indices into the local vertices of the partition,
+         * [2, 3] are unused by stretch constraints.
+         */
+        unsigned int localVertices[4];
+    };
+
+    /**
+     * Host (CPU) representation of a node of a TriangleBVH. Matches the memory
+     * layout of the BVHNode struct in kernels/bvh.cl
+     */
+    struct ATTR_PACKED BVHNode {
+        float lower[3];
+        int left; // index of the left child node, -1 for leaves
+        float upper[3];
+        int right; // index of the right child node, or the triangle of a leaf
+    };
+
+    /**
+     * Host (CPU) representation of a static collider, a SignedDistanceField in the shared brick
+     * buffers of SdfColliders. Matches the memory layout of the SdfCollider struct in kernels/sdf_collision.cl
+     */
+    struct ATTR_PACKED SdfCollider {
+        float origin[3];
+        float cellSize;
+        unsigned int numBricks[3];
+        unsigned int brickTableOffset; // of the collider's bricks in the shared brick table
+    };
+
+    /**
+     * Types of analytic colliders. Matches the COLLIDER_ defines in kernels/cloth_simulation.cl
+     */
+    enum class ColliderType : cl_uint {
+        PLANE = 0,
+        SPHERE = 1,
+        CAPSULE = 2,
+        BOX = 3
+    };
+
+    /**
+     * Host (CPU) representation of an analytic collider, see ColliderConfig. Matches the
+     * memory layout of the ColliderPrimitive struct in kernels/cloth_simulation.cl
+     */
+    struct ATTR_PACKED ColliderPrimitive {
+        ColliderType type;
+        float radius; // of spheres and capsules
+        float a[3]; // plane normal, sphere center, first capsule end or box center
+        float b[3]; // [offset of the plane along its normal, -, -], second capsule end or box half extents
+        float rotation[4]; // orientation quaternion [x, y, z, w] of boxes
+    };
 }
\ No newline at end of file
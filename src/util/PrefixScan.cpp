@@ -0,0 +1,72 @@
+#include "PrefixScan.hpp"
+
+#include <algorithm>
+
+#include "cl_util.hpp"
+
+namespace util {
+    PrefixScan::PrefixScan(cl::Context &context, cl::Device &device, uint maxElements)
+            : mWorkGroupSize(1), mMaxElements(maxElements) {
+        OCL_ERROR;
+
+        mProgram = LoadCLProgram("scan.cl", context, device);
+        OCL_CHECK(mScanBlocks = make_unique<cl::Kernel>(*mProgram, "scan_blocks", CL_ERROR));
+        OCL_CHECK(mAddBlockOffsets = make_unique<cl::Kernel>(*mProgram, "add_block_offsets", CL_ERROR));
+
+        // the tree of the scan needs a power-of-two work-group size
+        const ::size_t maxWorkGroupSize = std::min<::size_t>(
+                256, mScanBlocks->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+        while (2 * mWorkGroupSize <= maxWorkGroupSize) mWorkGroupSize *= 2;
+
+        /// one block sum per block of the level below, down to a single block
+        uint numElements = maxElements;
+        do {
+            const uint numBlocks = (numElements + blockSize() - 1) / blockSize();
+            OCL_CHECK(mBlockSums.push_back(cl::Buffer(context, CL_MEM_READ_WRITE,
+                                                      sizeof(cl_uint) * std::max(numBlocks, 1u),
+                                                      (void*)0, CL_ERROR)));
+            numElements = numBlocks;
+        } while (numElements > 1);
+    }
+
+    uint PrefixScan::enqueue(cl::CommandQueue &queue, const cl::Buffer &input, cl::Buffer &output,
+                             uint numElements, std::vector<cl::Event> *events) {
+        if (numElements == 0 || numElements > mMaxElements) return 0;
+        return enqueueLevel(queue, input, output, numElements, 0, events);
+    }
+
+    uint PrefixScan::blockSize() const {
+        return static_cast<uint>(2 * mWorkGroupSize);
+    }
+
+    uint PrefixScan::enqueueLevel(cl::CommandQueue &queue, const cl::Buffer &input, cl::Buffer &output,
+                                  uint numElements, uint level, std::vector<cl::Event> *events) {
+        const uint numBlocks = (numElements + blockSize() - 1) / blockSize();
+        const ::size_t localElements = blockSize() + (blockSize() - 1) / 32; // see CONFLICT_FREE_OFFSET
+
+        OCL_CALL(mScanBlocks->setArg(0, input));
+        OCL_CALL(mScanBlocks->setArg(1, output));
+        OCL_CALL(mScanBlocks->setArg(2, mBlockSums[level]));
+        OCL_CALL(mScanBlocks->setArg(3, numElements));
+        OCL_CALL(mScanBlocks->setArg(4, cl::Local(sizeof(cl_uint) * localElements)));
+        cl::Event event;
+        OCL_CALL(queue.enqueueNDRangeKernel(*mScanBlocks, cl::NullRange,
+                                            cl::NDRange(numBlocks * mWorkGroupSize),
+                                            cl::NDRange(mWorkGroupSize), NULL, &event));
+        if (events) events->push_back(event);
+        if (numBlocks == 1) return 1;
+
+        /// scan the block sums in place, then add them to every block but the first
+        const uint numLaunches = enqueueLevel(queue, mBlockSums[level], mBlockSums[level], numBlocks, level + 1,
+                                              events);
+
+        OCL_CALL(mAddBlockOffsets->setArg(0, output));
+        OCL_CALL(mAddBlockOffsets->setArg(1, mBlockSums[level]));
+        OCL_CALL(mAddBlockOffsets->setArg(2, blockSize()));
+        OCL_CALL(queue.enqueueNDRangeKernel(*mAddBlockOffsets, cl::NDRange(blockSize()),
+                                            cl::NDRange(numElements - blockSize()), cl::NullRange, NULL, &event));
+        if (events) events->push_back(event);
+
+        return numLaunches + 2;
+    }
+}
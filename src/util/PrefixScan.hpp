@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <CL/cl.hpp>
+
+namespace util {
+    /**
+     * Multi-level exclusive prefix sum of a uint buffer, see kernels/scan.cl. Every level scans blocks of
+     * blockSize() elements with a work-efficient (Blelloch) scan in local memory, the sums of the blocks are
+     * scanned recursively by the next level and added back. n elements take O(n) additions and
+     * 2 * ceil(log_blockSize(n)) - 1 launches, e.g. 5 launches for 10^7 elements with 512-element blocks.
+     */
+    class PrefixScan {
+    public:
+        /**
+         * Loads the scan kernels and allocates the block sums of every level for up to maxElements elements.
+         */
+        PrefixScan(cl::Context &context, cl::Device &device, uint maxElements);
+
+        /**
+         * Enqueues the exclusive scan of the first numElements (<= maxElements) elements of input into output,
+         * which may be the same buffer.
+         * @param events If not nullptr, the event of every launch is appended to it
+         * @return The number of enqueued kernel launches
+         */
+        uint enqueue(cl::CommandQueue &queue, const cl::Buffer &input, cl::Buffer &output, uint numElements,
+                     std::vector<cl::Event> *events = nullptr);
+
+        /**
+         * Returns the number of elements that a work-group of scan_blocks scans.
+         */
+        uint blockSize() const;
+
+    private:
+        uint enqueueLevel(cl::CommandQueue &queue, const cl::Buffer &input, cl::Buffer &output,
+                          uint numElements, uint level, std::vector<cl::Event> *events);
+
+        std::unique_ptr<cl::Program> mProgram;
+        std::unique_ptr<cl::Kernel> mScanBlocks;
+        std::unique_ptr<cl::Kernel> mAddBlockOffsets;
+
+        ::size_t mWorkGroupSize; // power of two, every work-item scans two elements
+        uint mMaxElements;
+
+        /// The block sums of every level, scanned in place by the next level
+        std::vector<cl::Buffer> mBlockSums;
+    };
+}
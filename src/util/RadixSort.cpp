@@ -0,0 +1,105 @@
+#include "RadixSort.hpp"
+
+#include <algorithm>
+
+#include "cl_util.hpp"
+
+namespace util {
+    /// Must match RADIX_BITS and RADIX in kernels/radix_sort.cl
+    static const uint RADIX_BITS = 4;
+    static const uint RADIX = 16;
+
+    RadixSort::RadixSort(cl::Context &context, cl::Device &device, uint maxElements)
+            : mMaxElements(maxElements) {
+        OCL_ERROR;
+
+        mProgram = LoadCLProgram("radix_sort.cl", context, device);
+        OCL_CHECK(mSortBlocks = make_unique<cl::Kernel>(*mProgram, "sort_blocks", CL_ERROR));
+        OCL_CHECK(mScatterBlocks = make_unique<cl::Kernel>(*mProgram, "scatter_blocks", CL_ERROR));
+        OCL_CHECK(mGather = make_unique<cl::Kernel>(*mProgram, "gather", CL_ERROR));
+
+        // a block has at least one element per digit, for the digit counts
+        mWorkGroupSize = std::max<::size_t>(RADIX, std::min<::size_t>(
+                256, mSortBlocks->getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device)));
+
+        const uint numElements = std::max(maxElements, 1u);
+        const uint maxBlocks = static_cast<uint>((numElements + mWorkGroupSize - 1) / mWorkGroupSize);
+        mDigitScan = make_unique<PrefixScan>(context, device, RADIX * maxBlocks);
+
+        OCL_CHECK(mBlockKeys = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * numElements,
+                                          (void *) 0, CL_ERROR));
+        OCL_CHECK(mBlockValues = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * numElements,
+                                            (void *) 0, CL_ERROR));
+        OCL_CHECK(mDigitCounts = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * RADIX * maxBlocks,
+                                            (void *) 0, CL_ERROR));
+        OCL_CHECK(mLocalDigitStarts = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * RADIX * maxBlocks,
+                                                 (void *) 0, CL_ERROR));
+    }
+
+    uint RadixSort::enqueue(cl::CommandQueue &queue, cl::Buffer &keys, cl::Buffer &values, uint numElements,
+                            uint numBits, std::vector<cl::Event> *events) {
+        if (numElements == 0 || numElements > mMaxElements) return 0;
+
+        const uint numBlocks = static_cast<uint>((numElements + mWorkGroupSize - 1) / mWorkGroupSize);
+        const ::size_t globalSize = numBlocks * mWorkGroupSize;
+
+        OCL_CALL(mSortBlocks->setArg(0, keys));
+        OCL_CALL(mSortBlocks->setArg(1, values));
+        OCL_CALL(mSortBlocks->setArg(2, mBlockKeys));
+        OCL_CALL(mSortBlocks->setArg(3, mBlockValues));
+        OCL_CALL(mSortBlocks->setArg(4, mDigitCounts));
+        OCL_CALL(mSortBlocks->setArg(5, mLocalDigitStarts));
+        OCL_CALL(mSortBlocks->setArg(6, numElements));
+        OCL_CALL(mSortBlocks->setArg(8, cl::Local(sizeof(cl_uint) * 2 * mWorkGroupSize)));
+        OCL_CALL(mSortBlocks->setArg(9, cl::Local(sizeof(cl_uint) * mWorkGroupSize)));
+        OCL_CALL(mSortBlocks->setArg(10, cl::Local(sizeof(cl_uint) * mWorkGroupSize)));
+        OCL_CALL(mSortBlocks->setArg(11, cl::Local(sizeof(cl_uint) * RADIX)));
+        OCL_CALL(mSortBlocks->setArg(12, cl::Local(sizeof(cl_uint) * RADIX)));
+
+        OCL_CALL(mScatterBlocks->setArg(0, mBlockKeys));
+        OCL_CALL(mScatterBlocks->setArg(1, mBlockValues));
+        OCL_CALL(mScatterBlocks->setArg(2, mDigitCounts));
+        OCL_CALL(mScatterBlocks->setArg(3, mLocalDigitStarts));
+        OCL_CALL(mScatterBlocks->setArg(4, keys));
+        OCL_CALL(mScatterBlocks->setArg(5, values));
+        OCL_CALL(mScatterBlocks->setArg(6, numElements));
+
+        uint numLaunches = 0;
+        cl::Event event;
+        for (uint shift = 0; shift < numBits; shift += RADIX_BITS) {
+            /// sort every block by the digit, then move the blocks' digit runs to their output indices
+            OCL_CALL(mSortBlocks->setArg(7, shift));
+            OCL_CALL(queue.enqueueNDRangeKernel(*mSortBlocks, cl::NullRange, cl::NDRange(globalSize),
+                                                cl::NDRange(mWorkGroupSize), NULL, &event));
+            if (events) events->push_back(event);
+
+            numLaunches += mDigitScan->enqueue(queue, mDigitCounts, mDigitCounts, RADIX * numBlocks, events);
+
+            OCL_CALL(mScatterBlocks->setArg(7, shift));
+            OCL_CALL(queue.enqueueNDRangeKernel(*mScatterBlocks, cl::NullRange, cl::NDRange(globalSize),
+                                                cl::NDRange(mWorkGroupSize), NULL, &event));
+            if (events) events->push_back(event);
+            numLaunches += 2;
+        }
+
+        return numLaunches;
+    }
+
+    uint RadixSort::enqueueGather(cl::CommandQueue &queue, const cl::Buffer &input, const cl::Buffer &permutation,
+                                  cl::Buffer &output, uint numElements, uint elementSize,
+                                  std::vector<cl::Event> *events) {
+        if (numElements == 0) return 0;
+
+        const uint wordsPerElement = elementSize / sizeof(cl_uint);
+        OCL_CALL(mGather->setArg(0, input));
+        OCL_CALL(mGather->setArg(1, permutation));
+        OCL_CALL(mGather->setArg(2, output));
+        OCL_CALL(mGather->setArg(3, wordsPerElement));
+
+        cl::Event event;
+        OCL_CALL(queue.enqueueNDRangeKernel(*mGather, cl::NullRange, cl::NDRange(numElements * wordsPerElement),
+                                            cl::NullRange, NULL, &event));
+        if (events) events->push_back(event);
+        return 1;
+    }
+}
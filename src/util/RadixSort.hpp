@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <CL/cl.hpp>
+
+#include "PrefixScan.hpp"
+
+namespace util {
+    /**
+     * Stable least-significant-digit radix sort of uint key-value pairs, see kernels/radix_sort.cl. Every pass
+     * sorts the blocks of one work-group by a 4-bit digit in local memory, scans the per-block digit counts with
+     * a PrefixScan and scatters the blocks to their output indices. Pairs with equal keys keep their order, so
+     * the result only depends on the input and not on the scheduling of the work-items.
+     */
+    class RadixSort {
+    public:
+        /**
+         * Loads the sort kernels and allocates the temporary buffers for up to maxElements pairs.
+         */
+        RadixSort(cl::Context &context, cl::Device &device, uint maxElements);
+
+        /**
+         * Enqueues the in-place sort of the first numElements (<= maxElements) pairs by the lowest numBits
+         * bits of their keys, the other bits must be 0.
+         * @param events If not nullptr, the event of every launch is appended to it
+         * @return The number of enqueued kernel launches
+         */
+        uint enqueue(cl::CommandQueue &queue, cl::Buffer &keys, cl::Buffer &values, uint numElements,
+                     uint numBits = 32, std::vector<cl::Event> *events = nullptr);
+
+        /**
+         * Enqueues output[i] = input[permutation[i]] for the first numElements elements of elementSize bytes (a
+         * multiple of 4), so that the values of a sort of element IDs reorder any buffer indexed by the IDs.
+         * @param events If not nullptr, the event of the launch is appended to it
+         * @return The number of enqueued kernel launches
+         */
+        uint enqueueGather(cl::CommandQueue &queue, const cl::Buffer &input, const cl::Buffer &permutation,
+                           cl::Buffer &output, uint numElements, uint elementSize,
+                           std::vector<cl::Event> *events = nullptr);
+
+    private:
+        std::unique_ptr<cl::Program> mProgram;
+        std::unique_ptr<cl::Kernel> mSortBlocks;
+        std::unique_ptr<cl::Kernel> mScatterBlocks;
+        std::unique_ptr<cl::Kernel> mGather;
+
+        ::size_t mWorkGroupSize;
+        uint mMaxElements;
+
+        std::unique_ptr<PrefixScan> mDigitScan;
+
+        /// The pairs sorted per block, and the digit counts and starts of every block
+        cl::Buffer mBlockKeys;
+        cl::Buffer mBlockValues;
+        cl::Buffer mDigitCounts;
+        cl::Buffer mLocalDigitStarts;
+    };
+}
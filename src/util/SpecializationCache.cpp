@@ -0,0 +1,48 @@
+#include "SpecializationCache.hpp"
+
+#include <chrono>
+
+#include "cl_util.hpp"
+
+namespace util {
+    SpecializationCache::SpecializationCache(cl::Context &context, cl::Device &device, const std::string &kernelName)
+            : mContext(context), mDevice(device), mKernelName(kernelName) {}
+
+    std::shared_ptr<cl::Program> SpecializationCache::get(const std::string &prefix, const std::string &options) {
+        const std::string key = options + "\n" + prefix;
+
+        /// collect the pending variant if it has finished compiling
+        if (mPendingVariant.valid() &&
+            mPendingVariant.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            // a variant that failed to compile is stored as nullptr, so that it isn't compiled again
+            mVariants[mPendingKey] = mPendingVariant.get();
+        }
+
+        auto it = mVariants.find(key);
+        if (it != mVariants.end()) {
+            return it->second;
+        }
+
+        /// only one variant is compiled at a time, the most recent request is picked up when it's done
+        if (!mPendingVariant.valid()) {
+            cl::Context context = mContext;
+            cl::Device device = mDevice;
+            const std::string kernelName = mKernelName;
+
+            mPendingKey = key;
+            mPendingVariant = std::async(std::launch::async, [=]() mutable {
+                return std::shared_ptr<cl::Program>(LoadCLProgram(kernelName, context, device, prefix, options));
+            });
+        }
+
+        return nullptr;
+    }
+
+    void SpecializationCache::clear() {
+        if (mPendingVariant.valid()) {
+            mPendingVariant.wait();
+            mPendingVariant = std::future<std::shared_ptr<cl::Program>>();
+        }
+        mVariants.clear();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <CL/cl.hpp>
+
+namespace util {
+    /**
+     * Cache of specialized variants of an OpenCL program, each compiled with its own
+     * prefix of #defines and build options. Variants are keyed by their prefix and
+     * options, and are compiled on a background thread so that the caller
+     * can keep using its current program until the variant is ready.
+     */
+    class SpecializationCache {
+    public:
+        SpecializationCache(cl::Context &context, cl::Device &device, const std::string &kernelName);
+
+        /**
+         * Gets the variant that is compiled with the prefix and options. If it is not
+         * compiled yet and no other variant is compiling, compilation is started.
+         * @return The variant, or nullptr if it is still compiling or failed to compile
+         */
+        std::shared_ptr<cl::Program> get(const std::string &prefix, const std::string &options = "");
+
+        /**
+         * Removes all variants, e.g. after the kernel source has changed. Blocks
+         * until the variant that is currently compiling (if any) is done.
+         */
+        void clear();
+
+    private:
+        cl::Context mContext;
+        cl::Device mDevice;
+        std::string mKernelName;
+
+        std::map<std::string, std::shared_ptr<cl::Program>> mVariants;
+
+        std::future<std::shared_ptr<cl::Program>> mPendingVariant;
+        std::string mPendingKey;
+    };
+}
@@ -21,7 +21,8 @@ namespace util {
     inline std::unique_ptr<cl::Program> LoadCLProgram(const std::string &kernelName,
                                                       cl::Context &context,
                                                       cl::Device &device,
-                                                      const std::string &prefix = "") {
+                                                      const std::string &prefix = "",
+                                                      const std::string &options = "") {
 
         std::unique_ptr<cl::Program> program = nullptr;
         std::string kernelSource = "";
@@ -29,10 +30,11 @@ namespace util {
             OCL_ERROR;
             OCL_CHECK(program = make_unique<cl::Program>(context,
                                                          prefix + "\n" + kernelSource,
-                                                         true,
+                                                         false,
                                                          CL_ERROR));
-            if (*CL_ERROR == CL_BUILD_PROGRAM_FAILURE) {
-                std::cerr << "Error building: "
+            const cl_int buildError = program->build(options.c_str());
+            if (buildError != CL_SUCCESS) {
+                std::cerr << "Error building (" << buildError << "): "
                           << program->getBuildInfo<CL_PROGRAM_BUILD_LOG>(device)
                           << std::endl;
 